@@ -27,33 +27,51 @@
 // USE_SOFTWARE_SERIAL
 //   If serial interface is software-based.
 //
+// USE_CAPTURE_SERIAL
+//   If serial interface is software-based using Timer1 to capture edges.
+//
 // USE_EEPROM_EMULATION
 //   If EEPROM is native or emulated.
+//
+// USE_TEMPERATURE_SENSOR
+//   If MCU has an internal temperature sensor.
 
 #if defined(ARDUINO_AVR_UNO)
 #define RAM_SIZE 2
-#define USE_SOFTWARE_SERIAL
+#undef USE_SOFTWARE_SERIAL
+#define USE_CAPTURE_SERIAL
 #undef USE_EEPROM_EMULATION
+#undef USE_TEMPERATURE_SENSOR
 #elif defined(ARDUINO_AVR_NANO)
 #define RAM_SIZE 2
-#define USE_SOFTWARE_SERIAL
+#undef USE_SOFTWARE_SERIAL
+#define USE_CAPTURE_SERIAL
 #undef USE_EEPROM_EMULATION
+#undef USE_TEMPERATURE_SENSOR
 #elif defined(ARDUINO_AVR_MEGA1280) || defined(ARDUINO_AVR_MEGA2560)
 #define RAM_SIZE 8
 #define USE_SOFTWARE_SERIAL
+#undef USE_CAPTURE_SERIAL
 #undef USE_EEPROM_EMULATION
+#undef USE_TEMPERATURE_SENSOR
 #elif defined(ARDUINO_SAMD_NANO_33_IOT)
 #define RAM_SIZE 32
 #undef USE_SOFTWARE_SERIAL
+#undef USE_CAPTURE_SERIAL
 #define USE_EEPROM_EMULATION
+#define USE_TEMPERATURE_SENSOR
 #elif defined(ARDUINO_ARDUINO_NANO33BLE)
 #define RAM_SIZE 256
 #undef USE_SOFTWARE_SERIAL
+#undef USE_CAPTURE_SERIAL
 #define USE_EEPROM_EMULATION
+#define USE_TEMPERATURE_SENSOR
 #elif defined(ARDUINO_AVR_NANO_EVERY)
 #define RAM_SIZE 6
 #undef USE_SOFTWARE_SERIAL
+#undef USE_CAPTURE_SERIAL
 #undef USE_EEPROM_EMULATION
+#undef USE_TEMPERATURE_SENSOR
 #else
 #error "ARDUINO_?: board type not supported"
 #endif
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "captureserial.h"
+
+#if defined(USE_CAPTURE_SERIAL)
+
+#include <avr/interrupt.h>
+
+// Timer1 runs at F_CPU/8, which is 0.5 us per tick on a 16 MHz board.
+static const uint32_t TICKS_PER_SECOND = F_CPU / 8;
+
+// Pin that is wired to the input capture unit of Timer1 on the ATmega328P.
+static const uint8_t ICP_PIN = 8;
+
+// Bit positions within a frame, where 0 is the start bit, 1-8 are data bits and 9 is the stop bit.
+static const uint8_t BIT_STOP = 9;
+static const uint8_t BIT_IDLE = 0xFF;
+
+// Only a single instance is supported since the receiver owns Timer1.
+static capture_serial* instance = nullptr;
+
+capture_serial::capture_serial(uint8_t rx_pin, uint8_t tx_pin)
+  : rx_pin(rx_pin),
+    tx_pin(tx_pin),
+    use_icp(rx_pin == ICP_PIN),
+    bit_ticks(0),
+    rx_port(portInputRegister(digitalPinToPort(rx_pin))),
+    rx_mask(digitalPinToBitMask(rx_pin)),
+    tx_port(portOutputRegister(digitalPinToPort(tx_pin))),
+    tx_mask(digitalPinToBitMask(tx_pin)),
+    rx_start(0),
+    rx_index(BIT_IDLE),
+    rx_byte(0),
+    rx_level(true),
+    rx_high(true) {
+  instance = this;
+}
+
+void capture_serial::begin(long baud_rate) {
+  buffer.clear();
+  noInterrupts();
+  bit_ticks = TICKS_PER_SECOND / baud_rate;
+  rx_index = BIT_IDLE;
+  rx_high = true;
+
+  pinMode(rx_pin, INPUT_PULLUP);
+  pinMode(tx_pin, OUTPUT);
+  *tx_port |= tx_mask;
+
+  // Free-running timer with prescaler of 8. The first edge of interest is always the falling edge
+  // of a start bit. Only the interrupts owned by the receiver are cleared, since compare unit B may
+  // be producing pulses and the receiver is restarted whenever the baud rate changes.
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TCCR1C = 0;
+  TIMSK1 &= ~(_BV(ICIE1) | _BV(OCIE1A));
+  if (use_icp) {
+    TCCR1B |= _BV(ICNC1);
+    TIFR1 = _BV(ICF1);
+    TIMSK1 |= _BV(ICIE1);
+  } else {
+    *digitalPinToPCMSK(rx_pin) |= _BV(digitalPinToPCMSKbit(rx_pin));
+    *digitalPinToPCICR(rx_pin) |= _BV(digitalPinToPCICRbit(rx_pin));
+  }
+  interrupts();
+}
+
+int capture_serial::available() {
+  return buffer.size();
+}
+
+int capture_serial::read() {
+  return buffer.get();
+}
+
+int capture_serial::peek() {
+  return buffer.peek();
+}
+
+size_t capture_serial::write(uint8_t b) {
+  // Timer1 keeps running with interrupts disabled, so bit boundaries are measured against it
+  // rather than relying on calibrated delays.
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t t = TCNT1;
+  *tx_port &= ~tx_mask;
+  for (uint8_t i = 0; i < 10; ++i) {
+    t += bit_ticks;
+    while (static_cast<int16_t>(TCNT1 - t) < 0)
+      ;
+    if (i < 8 ? b & (1 << i) : true)
+      *tx_port |= tx_mask;
+    else
+      *tx_port &= ~tx_mask;
+  }
+  SREG = sreg;
+  return 1;
+}
+
+const ring_buffer& capture_serial::get_buffer() const {
+  return buffer;
+}
+
+void capture_serial::edge(uint16_t ticks, bool high) {
+  if (rx_index == BIT_IDLE) {
+    if (!high) {
+      // Falling edge of start bit, so arm the timeout for the middle of the stop bit in case the
+      // trailing bits of the frame are all 1 and produce no further edges.
+      rx_start = ticks;
+      rx_index = 0;
+      rx_byte = 0;
+      rx_level = false;
+      OCR1A = ticks + bit_ticks * BIT_STOP + bit_ticks / 2;
+      TIFR1 = _BV(OCF1A);
+      TIMSK1 |= _BV(OCIE1A);
+    }
+  } else {
+    // All bits between the prior edge and this one were at the prior level.
+    uint16_t index = static_cast<uint16_t>(ticks - rx_start + bit_ticks / 2) / bit_ticks;
+    if (index > BIT_STOP) {
+      set_bits(rx_index, BIT_STOP);
+      finish(rx_level);
+    } else {
+      set_bits(rx_index, index);
+      rx_index = index;
+      rx_level = high;
+      if (index == BIT_STOP)
+        finish(high);
+    }
+    // Edge may well be the start bit of the next frame.
+    if (rx_index == BIT_IDLE && !high)
+      edge(ticks, high);
+  }
+}
+
+void capture_serial::pin_change(uint16_t ticks) {
+  // Interrupt is shared by all pins on the same port, so ignore changes on other pins.
+  bool high = (*rx_port & rx_mask) != 0;
+  if (high != rx_high) {
+    rx_high = high;
+    edge(ticks, high);
+  }
+}
+
+void capture_serial::timeout() {
+  if (rx_index != BIT_IDLE) {
+    set_bits(rx_index, BIT_STOP);
+    finish(rx_level);
+  }
+}
+
+void capture_serial::set_bits(uint8_t from, uint8_t to) {
+  if (rx_level) {
+    for (uint8_t i = from < 1 ? 1 : from; i < to && i <= 8; ++i)
+      rx_byte |= 1 << (i - 1);
+  }
+}
+
+void capture_serial::finish(bool stop_ok) {
+  TIMSK1 &= ~_BV(OCIE1A);
+  rx_index = BIT_IDLE;
+  rx_level = true;
+
+  // Frames without a valid stop bit are dropped.
+  if (stop_ok)
+    buffer.put(rx_byte);
+}
+
+ISR(TIMER1_CAPT_vect) {
+  // Level after the edge is implied by which edge was selected, which is then flipped to catch the
+  // opposite edge. Changing the edge select can raise a spurious capture flag, so clear it.
+  uint16_t ticks = ICR1;
+  bool high = TCCR1B & _BV(ICES1);
+  TCCR1B ^= _BV(ICES1);
+  TIFR1 = _BV(ICF1);
+  instance->edge(ticks, high);
+}
+
+ISR(TIMER1_COMPA_vect) {
+  instance->timeout();
+}
+
+// Pin change interrupts are shared by all pins of a port, so only the vector of the port of the
+// receive pin is defined, leaving the others free for other libraries, and none at all when edges
+// are captured by ICP1. The receive pin, which connects to the TX lead of the GPS module, is known
+// to the preprocessor only by the name GPS_TX_PIN_n given to it by config.h, so all vectors are
+// defined if the name is missing, e.g. from a config.h written by hand.
+#if defined(GPS_TX_PIN_8)
+#elif defined(GPS_TX_PIN_0) || defined(GPS_TX_PIN_1) || defined(GPS_TX_PIN_2) || \
+    defined(GPS_TX_PIN_3) || defined(GPS_TX_PIN_4) || defined(GPS_TX_PIN_5) || \
+    defined(GPS_TX_PIN_6) || defined(GPS_TX_PIN_7)
+ISR(PCINT2_vect) {
+  instance->pin_change(TCNT1);
+}
+#elif defined(GPS_TX_PIN_9) || defined(GPS_TX_PIN_10) || defined(GPS_TX_PIN_11) || \
+    defined(GPS_TX_PIN_12) || defined(GPS_TX_PIN_13)
+ISR(PCINT0_vect) {
+  instance->pin_change(TCNT1);
+}
+#elif defined(GPS_TX_PIN_14) || defined(GPS_TX_PIN_15) || defined(GPS_TX_PIN_16) || \
+    defined(GPS_TX_PIN_17) || defined(GPS_TX_PIN_18) || defined(GPS_TX_PIN_19) || \
+    defined(GPS_TX_PIN_A0) || defined(GPS_TX_PIN_A1) || defined(GPS_TX_PIN_A2) || \
+    defined(GPS_TX_PIN_A3) || defined(GPS_TX_PIN_A4) || defined(GPS_TX_PIN_A5)
+ISR(PCINT1_vect) {
+  instance->pin_change(TCNT1);
+}
+#else
+ISR(PCINT0_vect) {
+  instance->pin_change(TCNT1);
+}
+
+ISR(PCINT1_vect) {
+  instance->pin_change(TCNT1);
+}
+
+ISR(PCINT2_vect) {
+  instance->pin_change(TCNT1);
+}
+#endif
+
+#endif
\ No newline at end of file
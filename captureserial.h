@@ -0,0 +1,75 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CAPTURESERIAL_H
+#define __CAPTURESERIAL_H
+
+#include <Arduino.h>
+#include "board.h"
+#include "ring.h"
+
+#if defined(USE_CAPTURE_SERIAL)
+
+// Serial receiver that timestamps edges of the incoming signal using Timer1 rather than sampling
+// each bit with interrupts disabled, which is what SoftwareSerial does. When the receive pin is
+// ICP1 (pin 8), edges are timestamped by the input capture unit in hardware, otherwise the timer
+// is read from a pin change interrupt. Either way, interrupts remain enabled while receiving, so
+// millis() and Wire transfers are unaffected.
+//
+// Transmission is bit-banged with interrupts disabled, which is acceptable since it is only used
+// for occasional commands sent to the GPS module.
+class capture_serial : public Stream {
+public:
+  capture_serial(uint8_t rx_pin, uint8_t tx_pin);
+  void begin(long baud_rate);
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t b) override;
+  using Print::write;
+  const ring_buffer& get_buffer() const;
+
+  // Invoked only by interrupt handlers.
+  void edge(uint16_t ticks, bool high);
+  void pin_change(uint16_t ticks);
+  void timeout();
+
+private:
+  uint8_t rx_pin;
+  uint8_t tx_pin;
+  bool use_icp;
+  uint16_t bit_ticks;
+  volatile uint8_t* rx_port;
+  uint8_t rx_mask;
+  volatile uint8_t* tx_port;
+  uint8_t tx_mask;
+
+  // State of byte currently being received.
+  uint16_t rx_start;
+  uint8_t rx_index;
+  uint8_t rx_byte;
+  bool rx_level;
+  bool rx_high;
+
+  // Filled by interrupt handlers and drained by read().
+  ring_buffer buffer;
+
+  void set_bits(uint8_t from, uint8_t to);
+  void finish(bool stop_ok);
+};
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "civil.h"
+
+// Number of days from 0000-03-01 to 1970-01-01, since the algorithms below count days from the
+// start of March so that leap days fall at the end of the year.
+static const int32_t EPOCH_DAYS = 719468;
+
+// Number of days in a 400-year era, after which the calendar repeats.
+static const int32_t ERA_DAYS = 146097;
+
+int32_t days_from_civil(uint16_t year, uint8_t month, uint8_t day) {
+  // Algorithm by Howard Hinnant, restricted to years from 0 onwards.
+  uint32_t y = year - (month <= 2 ? 1 : 0);
+  uint32_t era = y / 400;
+  uint32_t yoe = y - era * 400;
+  uint32_t doy = (153 * static_cast<uint32_t>(month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return static_cast<int32_t>(era * ERA_DAYS + doe) - EPOCH_DAYS;
+}
+
+civil_time civil_from_days(int32_t days) {
+  // Inverse of days_from_civil(), restricted to days on or after 0000-03-01.
+  uint32_t z = static_cast<uint32_t>(days + EPOCH_DAYS);
+  uint32_t era = z / ERA_DAYS;
+  uint32_t doe = z - era * ERA_DAYS;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  uint8_t month = mp < 10 ? mp + 3 : mp - 9;
+  return civil_time {
+    static_cast<uint16_t>(yoe + era * 400 + (month <= 2 ? 1 : 0)),
+    month,
+    static_cast<uint8_t>(doy - (153 * mp + 2) / 5 + 1),
+    weekday_from_days(days),
+    0,
+    0,
+    0
+  };
+}
+
+uint8_t weekday_from_days(int32_t days) {
+  // 1970-01-01 was a Thursday.
+  return static_cast<uint8_t>((days % 7 + 11) % 7 + 1);
+}
+
+time_t to_epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+  return static_cast<time_t>(days_from_civil(year, month, day)) * SECS_PER_DAY +
+    static_cast<time_t>(hour) * SECS_PER_HOUR + minute * SECS_PER_MIN + second;
+}
+
+civil_time from_epoch(time_t time) {
+  uint32_t seconds = static_cast<uint32_t>(time % SECS_PER_DAY);
+  civil_time ct = civil_from_days(static_cast<int32_t>(time / SECS_PER_DAY));
+  ct.hour = seconds / SECS_PER_HOUR;
+  ct.minute = seconds / SECS_PER_MIN % 60;
+  ct.second = seconds % SECS_PER_MIN;
+  return ct;
+}
+
+civil_calendar::civil_calendar()
+  : last {},
+    last_time(0),
+    day_start(0),
+    valid(false) {
+}
+
+civil_time civil_calendar::split(time_t time) {
+  if (!valid || time != last_time + 1 || !advance()) {
+    // Date is only recomputed if the time falls on a different day than before.
+    if (!valid || time < day_start || time - day_start >= SECS_PER_DAY) {
+      day_start = time - time % SECS_PER_DAY;
+      last = civil_from_days(static_cast<int32_t>(time / SECS_PER_DAY));
+      valid = true;
+    }
+    uint32_t seconds = static_cast<uint32_t>(time - day_start);
+    last.hour = seconds / SECS_PER_HOUR;
+    last.minute = seconds / SECS_PER_MIN % 60;
+    last.second = seconds % SECS_PER_MIN;
+  }
+  last_time = time;
+  return last;
+}
+
+bool civil_calendar::advance() {
+  // Carries a second into the time of day, which fails at midnight since the date changes.
+  if (++last.second < 60)
+    return true;
+  last.second = 0;
+  if (++last.minute < 60)
+    return true;
+  last.minute = 0;
+  return ++last.hour < 24;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CIVIL_H
+#define __CIVIL_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+// Time of day and date in the proleptic Gregorian calendar, where weekday is 1 for Sunday through
+// 7 for Saturday, as in TimeLib.
+struct civil_time {
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t weekday;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+};
+
+// Conversions between civil dates and days since 1970-01-01 using a fixed number of integer
+// operations, whereas TimeLib walks every year and month since 1970.
+int32_t days_from_civil(uint16_t year, uint8_t month, uint8_t day);
+civil_time civil_from_days(int32_t days);
+uint8_t weekday_from_days(int32_t days);
+
+// Conversions between civil time and seconds since 1970-01-01.
+time_t to_epoch(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+civil_time from_epoch(time_t time);
+
+// Converts a series of times into civil time, where a time one second after the previous one is
+// handled by advancing the time of day, and the calendar is only consulted again when the day
+// changes, e.g. at midnight.
+class civil_calendar {
+public:
+  civil_calendar();
+  civil_time split(time_t time);
+
+private:
+  civil_time last;
+  time_t last_time;
+  time_t day_start;
+  bool valid;
+
+  bool advance();
+};
+
+#endif
@@ -14,42 +14,415 @@
  * limitations under the License.
  */
 #include "clock.h"
+#include "config.h"
 
-local_clock::local_clock(const tz_info* tz)
-  : tz(tz),
-    last_time(0) {
+// Number of milliseconds in a second.
+static const uint32_t SECOND_MS = 1000;
+static const uint32_t HALF_SECOND_MS = SECOND_MS / 2;
+
+// Number of nanoseconds in a second and a millisecond.
+static const uint32_t SECOND_NS = 1000000000;
+static const uint32_t MILLISECOND_NS = 1000000;
+
+// Maximum number of milliseconds by which a single second is lengthened or shortened when
+// slewing, which amounts to 1% of a second.
+static const int32_t MAX_SLEW_MS = 10;
+
+// Minimum number of seconds between synchronizations used to estimate drift, which must be long
+// enough that the jitter in estimating the start of a second becomes insignificant.
+static const uint32_t DRIFT_BASELINE_S = 900;
+
+// Maximum number of seconds between synchronizations used to estimate drift, beyond which the
+// reference point is simply reset, e.g. after a lengthy outage.
+static const uint32_t MAX_BASELINE_S = 86400;
+
+// Weight given to each new measurement of drift, expressed as a divisor.
+static const int32_t DRIFT_SMOOTHING = 4;
+
+// Maximum drift in parts per billion that is believable for a board oscillator.
+static const int32_t MAX_DRIFT_PPB = 10000000;
+
+// Drift estimate is only persisted when it differs by this much from what was last persisted,
+// and no more than once in the given period, since storage endures a limited number of writes.
+static const int32_t DRIFT_SAVE_PPB = 1000;
+static const uint32_t DRIFT_SAVE_MS = 86400000;
+
+// Uncertainty in milliseconds of synchronizations that rely on the arrival of GPS time, as
+// opposed to the edge of a PPS signal.
+static const uint32_t SERIAL_UNCERTAINTY_MS = 20;
+static const uint32_t PPS_UNCERTAINTY_MS = 1;
+
+// Frequency error in parts per million presumed during holdover with and without an estimate of
+// drift, respectively.
+static const uint32_t CALIBRATED_PPM = 10;
+static const uint32_t UNCALIBRATED_PPM = 500;
+
+// Number of milliseconds since the last synchronization with GPS time during which the clock is
+// considered locked, after which it is in holdover.
+static const uint32_t LOCK_MS = 10000;
+
+#if defined(USE_TEMPERATURE_SENSOR)
+// Marks the absence of a temperature reading.
+static const float TEMPERATURE_UNKNOWN = NAN;
+#endif
+
+local_clock::local_clock(tz_database* tz_db, const tz_info& tz)
+  : tz_db(tz_db),
+    tz_index(tz.index),
+    last_time(0),
+    last_phase(0),
+    base_time(0),
+    base_ms(0),
+    base_ns(0),
+    slew_ms(0),
+    offset(0),
+    accuracy_ns(ACCURACY_UNKNOWN),
+    sync_ms(0),
+    sync_uncertainty_ms(0),
+    reference_ms(0),
+    referenced(false),
+    anchor_time(0),
+    anchor_ms(0),
+    drift_ppb(0),
+    applied_ppb(0),
+    calibrated(false),
+    saved_ppb(0),
+    saved_ms(0),
+    saved(false) {
+#if defined(USE_TEMPERATURE_SENSOR)
+  temperature = TEMPERATURE_UNKNOWN;
+  temp_sum = 0;
+  temp_min = 0;
+  temp_max = 0;
+  temp_samples = 0;
+  table_changed = false;
+  table_saved_ms = 0;
+  table_saved = false;
+  for (uint8_t i = 0; i < DRIFT_BINS; ++i)
+    table.drift_ppb[i] = DRIFT_UNKNOWN;
+#endif
 }
 
 bool local_clock::tick() {
   if (is_sync()) {
-    time_t cur_time = ::now();
+    time_t cur_time = utc();
     bool ticked = cur_time != last_time;
     last_time = cur_time;
+    last_phase = millis() - base_ms;
     return ticked;
   } else
     return false;
 }
 
 local_time local_clock::now() {
-  time_t t = const_cast<tz_info*>(tz)->tz.toLocal(last_time);
+  civil_time ct = calendar.split(to_local(last_time));
   return local_time {
-    static_cast<uint16_t>(year(t)),
-    static_cast<uint8_t>(month(t)),
-    static_cast<uint8_t>(day(t)),
-    static_cast<uint8_t>(hour(t)),
-    static_cast<uint8_t>(minute(t)),
-    static_cast<uint8_t>(second(t))
+    ct.year,
+    ct.month,
+    ct.day,
+    ct.hour,
+    ct.minute,
+    ct.second,
+    static_cast<uint16_t>(last_phase < SECOND_MS ? last_phase : SECOND_MS - 1)
   };
 }
 
-void local_clock::set_tz(const tz_info* tz) {
-  this->tz = tz;
+time_t local_clock::get_utc() {
+  return is_sync() ? utc() : 0;
+}
+
+uint32_t local_clock::get_phase() {
+  // Milliseconds elapsed since the start of the current second.
+  if (!is_sync())
+    return 0;
+  utc();
+  return millis() - base_ms;
+}
+
+uint32_t local_clock::until_next() {
+  // Milliseconds remaining until the start of the next second, accounting for drift and slewing,
+  // which allows the caller to update displays within a bounded latency of the true second.
+  if (!is_sync())
+    return SECOND_MS;
+  utc();
+  int32_t slew;
+  uint32_t ns;
+  uint32_t elapsed_ms = millis() - base_ms;
+  uint32_t length_ms = length(slew, ns);
+  return elapsed_ms < length_ms ? length_ms - elapsed_ms : 0;
+}
+
+void local_clock::set_tz(const tz_info& tz) {
+  tz_index = tz.index;
 }
 
 void local_clock::sync(const gps_time& time) {
-  setTime(time.hour, time.minute, time.second, time.day, time.month, time.year);
+  // Start of the second is estimated by the GPS unit, though an estimate that lands in the future
+  // is clearly wrong.
+  uint32_t ms = millis();
+  uint32_t start_ms = static_cast<int32_t>(ms - time.start_ms) < 0 ? ms : time.start_ms;
+  discipline(to_time(time), start_ms, SERIAL_UNCERTAINTY_MS, true);
+  offset = 0;
+  accuracy_ns = time.accuracy_ns;
+}
+
+void local_clock::sync(const gps_time& time, uint32_t edge_ms) {
+  // The edge marks the true beginning of the second, whereas the GPS time only labels which second
+  // it was. An edge captured after the time was decoded belongs to the following second, so the
+  // edge is matched to the estimated start of the second.
+  int32_t delta = static_cast<int32_t>(edge_ms - time.start_ms);
+  if (delta > static_cast<int32_t>(HALF_SECOND_MS)) {
+    edge_ms -= SECOND_MS;
+    delta -= SECOND_MS;
+  }
+  if (abs(delta) <= static_cast<int32_t>(HALF_SECOND_MS)) {
+    discipline(to_time(time), edge_ms, PPS_UNCERTAINTY_MS, true);
+    offset = -delta;
+    accuracy_ns = time.accuracy_ns;
+  } else
+    sync(time);
+}
+
+void local_clock::hold(const gps_time& time, uint32_t uncertainty_ms) {
+  // A secondary source of time, such as an RTC, keeps the clock running during holdover, though
+  // it is not a reference against which drift of the board oscillator can be measured.
+  discipline(to_time(time), time.start_ms, uncertainty_ms, false);
+  offset = 0;
+  accuracy_ns = time.accuracy_ns;
 }
 
 bool local_clock::is_sync() {
-  return timeStatus() != timeNotSet;
+  return base_time != 0;
+}
+
+bool local_clock::is_locked() {
+  return referenced && millis() - reference_ms < LOCK_MS;
+}
+
+int32_t local_clock::get_offset() {
+  return offset;
+}
+
+uint32_t local_clock::get_accuracy() {
+  // Accuracy of GPS time at the last synchronization, which is only estimated by some modules.
+  return accuracy_ns;
+}
+
+uint32_t local_clock::get_uncertainty() {
+  // Uncertainty at the last synchronization grows during holdover at a rate that depends on
+  // whether drift has been estimated, and includes any phase error not yet slewed away.
+  if (!is_sync())
+    return UINT32_MAX;
+  uint32_t elapsed_s = (millis() - sync_ms) / SECOND_MS;
+  uint32_t ppm = calibrated ? CALIBRATED_PPM : UNCALIBRATED_PPM;
+  return sync_uncertainty_ms + abs(slew_ms) + elapsed_s * ppm / 1000;
+}
+
+int32_t local_clock::get_drift() {
+  return drift_ppb;
+}
+
+void local_clock::set_drift(int32_t drift_ppb) {
+  // Drift persisted from a prior run is presumed accurate until the next estimate.
+  if (drift_ppb > -MAX_DRIFT_PPB && drift_ppb < MAX_DRIFT_PPB) {
+    this->drift_ppb = drift_ppb;
+    calibrated = true;
+    saved_ppb = drift_ppb;
+    saved = true;
+    compensate();
+  }
+}
+
+bool local_clock::take_drift(int32_t& drift_ppb) {
+  // Returns the drift estimate if it has changed enough since it was last taken that it should be
+  // persisted, in which case it is presumed to have been persisted.
+  if (!calibrated)
+    return false;
+  if (saved && (abs(this->drift_ppb - saved_ppb) < DRIFT_SAVE_PPB || millis() - saved_ms < DRIFT_SAVE_MS))
+    return false;
+  drift_ppb = this->drift_ppb;
+  saved_ppb = drift_ppb;
+  saved_ms = millis();
+  saved = true;
+  return true;
+}
+
+#if defined(USE_TEMPERATURE_SENSOR)
+void local_clock::set_temperature(float celsius) {
+  // Readings are accumulated over the period in which drift is measured so the measurement can be
+  // attributed to a temperature.
+  temperature = celsius;
+  temp_sum += celsius;
+  temp_min = temp_samples == 0 || celsius < temp_min ? celsius : temp_min;
+  temp_max = temp_samples == 0 || celsius > temp_max ? celsius : temp_max;
+  if (temp_samples < UINT16_MAX)
+    ++temp_samples;
+  compensate();
+}
+
+void local_clock::set_table(const drift_table& table) {
+  // Table persisted from a prior run, where implausible values are treated as unknown.
+  for (uint8_t i = 0; i < DRIFT_BINS; ++i) {
+    int32_t ppb = table.drift_ppb[i];
+    this->table.drift_ppb[i] = ppb > -MAX_DRIFT_PPB && ppb < MAX_DRIFT_PPB ? ppb : DRIFT_UNKNOWN;
+  }
+  table_saved = true;
+  compensate();
+}
+
+bool local_clock::take_table(drift_table& table) {
+  // Returns the table if it has changed since it was last taken, subject to the same limit on how
+  // often drift is persisted.
+  if (!table_changed || (table_saved && millis() - table_saved_ms < DRIFT_SAVE_MS))
+    return false;
+  table = this->table;
+  table_changed = false;
+  table_saved_ms = millis();
+  table_saved = true;
+  return true;
+}
+#endif
+
+time_t local_clock::utc() {
+  // Advance the reference point one second at a time, where each second is measured in ticks of
+  // millis() corrected for drift and lengthened or shortened to slew any phase error. This also
+  // keeps elapsed time from approaching the rollover of millis().
+  uint32_t ms = millis();
+  for (;;) {
+    int32_t slew;
+    uint32_t ns;
+    uint32_t length_ms = length(slew, ns);
+    if (ms - base_ms < length_ms)
+      break;
+    ++base_time;
+    base_ms += length_ms;
+    base_ns = ns % MILLISECOND_NS;
+    slew_ms -= slew;
+  }
+  return base_time;
+}
+
+time_t local_clock::to_local(time_t time) {
+  // Offsets of all timezones are kept by the database, which only recomputes them when some
+  // timezone passes a transition, so changing the timezone is no more costly than a tick.
+  tz_db->update(time);
+  return time + tz_db->get_offset(tz_index);
+}
+
+uint32_t local_clock::length(int32_t& slew, uint32_t& ns) {
+  // Length of the current second in ticks of millis(), along with the portion of any phase error
+  // slewed away during that second and the fractional nanoseconds carried into the next.
+  slew = slew_ms > MAX_SLEW_MS ? MAX_SLEW_MS : (slew_ms < -MAX_SLEW_MS ? -MAX_SLEW_MS : slew_ms);
+  ns = base_ns + SECOND_NS + applied_ppb;
+  return ns / MILLISECOND_NS + slew;
+}
+
+void local_clock::discipline(time_t time, uint32_t start_ms, uint32_t uncertainty_ms, bool reference) {
+  if (is_sync()) {
+    // Phase error is the difference between the true start of the second and when the clock
+    // believes the second started, which is small enough to slew away in most cases.
+    utc();
+    int32_t secs = static_cast<int32_t>(time - base_time);
+    int32_t error = static_cast<int32_t>(start_ms - base_ms) - secs * static_cast<int32_t>(SECOND_MS);
+    if (abs(secs) > 1 || abs(error) > static_cast<int32_t>(CLOCK_STEP_MS))
+      step(time, start_ms);
+    else
+      slew_ms = error;
+  } else
+    step(time, start_ms);
+  if (reference) {
+    estimate(time, start_ms);
+    reference_ms = millis();
+    referenced = true;
+  }
+  sync_ms = millis();
+  sync_uncertainty_ms = uncertainty_ms;
+}
+
+void local_clock::step(time_t time, uint32_t start_ms) {
+  base_time = time;
+  base_ms = start_ms;
+  base_ns = 0;
+  slew_ms = 0;
+  anchor_time = 0;
+}
+
+void local_clock::estimate(time_t time, uint32_t start_ms) {
+  // Drift is measured in raw ticks of millis() elapsed between two synchronizations compared to
+  // the number of seconds that actually elapsed, and is then smoothed.
+  if (anchor_time == 0) {
+    anchor(time, start_ms);
+    return;
+  }
+  uint32_t secs = time - anchor_time;
+  if (secs > MAX_BASELINE_S)
+    anchor(time, start_ms);
+  else if (secs >= DRIFT_BASELINE_S) {
+    int32_t excess_ms = static_cast<int32_t>(start_ms - anchor_ms - secs * SECOND_MS);
+    int32_t measured = static_cast<int32_t>(static_cast<int64_t>(excess_ms) * MILLISECOND_NS / secs);
+    if (measured > -MAX_DRIFT_PPB && measured < MAX_DRIFT_PPB) {
+      drift_ppb = calibrated ? drift_ppb + (measured - drift_ppb) / DRIFT_SMOOTHING : measured;
+      calibrated = true;
+#if defined(USE_TEMPERATURE_SENSOR)
+      learn(measured);
+#endif
+      compensate();
+    }
+    anchor(time, start_ms);
+  }
+}
+
+void local_clock::anchor(time_t time, uint32_t start_ms) {
+  anchor_time = time;
+  anchor_ms = start_ms;
+#if defined(USE_TEMPERATURE_SENSOR)
+  temp_sum = 0;
+  temp_samples = 0;
+#endif
+}
+
+void local_clock::compensate() {
+  // Drift applied to the clock is the estimate learned at the current temperature if available,
+  // interpolating between adjacent bins, and otherwise the overall estimate.
+  applied_ppb = drift_ppb;
+#if defined(USE_TEMPERATURE_SENSOR)
+  if (isnan(temperature))
+    return;
+  int8_t bin = to_bin(temperature);
+  if (bin < 0 || table.drift_ppb[bin] == DRIFT_UNKNOWN)
+    return;
+  applied_ppb = table.drift_ppb[bin];
+
+  // Position of the temperature relative to the center of its bin, in the range [-0.5, 0.5).
+  float pos = (temperature - DRIFT_MIN_C) / DRIFT_BIN_C - bin - 0.5f;
+  int8_t other = pos < 0 ? bin - 1 : bin + 1;
+  if (other >= 0 && other < DRIFT_BINS && table.drift_ppb[other] != DRIFT_UNKNOWN)
+    applied_ppb += static_cast<int32_t>((table.drift_ppb[other] - table.drift_ppb[bin]) * fabs(pos));
+#endif
+}
+
+#if defined(USE_TEMPERATURE_SENSOR)
+void local_clock::learn(int32_t measured) {
+  // A measurement is attributed to a bin only if the temperature held steady while it was taken.
+  if (temp_samples == 0 || temp_max - temp_min > DRIFT_BIN_C)
+    return;
+  int8_t bin = to_bin(temp_sum / temp_samples);
+  if (bin < 0)
+    return;
+  int32_t ppb = table.drift_ppb[bin];
+  int32_t learned = ppb == DRIFT_UNKNOWN ? measured : ppb + (measured - ppb) / DRIFT_SMOOTHING;
+  if (ppb == DRIFT_UNKNOWN || abs(learned - ppb) >= DRIFT_SAVE_PPB)
+    table_changed = true;
+  table.drift_ppb[bin] = learned;
+}
+
+int8_t local_clock::to_bin(float celsius) {
+  // Returns -1 if the temperature is outside the range of the table.
+  float bin = floor((celsius - DRIFT_MIN_C) / DRIFT_BIN_C);
+  return bin >= 0 && bin < DRIFT_BINS ? static_cast<int8_t>(bin) : -1;
+}
+#endif
+
+time_t local_clock::to_time(const gps_time& time) {
+  return to_epoch(time.year, time.month, time.day, time.hour, time.minute, time.second);
 }
\ No newline at end of file
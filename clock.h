@@ -18,6 +18,7 @@
 
 #include <Arduino.h>
 #include <TimeLib.h>
+#include "civil.h"
 #include "gps.h"
 #include "timezones.h"
 
@@ -28,20 +29,101 @@ struct local_time {
   uint8_t hour;
   uint8_t minute;
   uint8_t second;
+  uint16_t millisecond;
 };
 
+#if defined(USE_TEMPERATURE_SENSOR)
+// Table of oscillator drift learned at different temperatures, where each bin spans DRIFT_BIN_C
+// degrees Celsius starting at DRIFT_MIN_C, and bins not yet learned contain DRIFT_UNKNOWN.
+static const int8_t DRIFT_MIN_C = -20;
+static const uint8_t DRIFT_BIN_C = 2;
+static const uint8_t DRIFT_BINS = 40;
+static const int32_t DRIFT_UNKNOWN = INT32_MIN;
+
+struct drift_table {
+  int32_t drift_ppb[DRIFT_BINS];
+};
+#endif
+
+// Clock that runs on millis() between synchronizations with GPS time. The frequency error of the
+// board oscillator is estimated from synchronizations that are far enough apart, and small phase
+// errors are slewed by lengthening or shortening seconds rather than stepping, so that seconds are
+// never skipped or repeated.
 class local_clock {
 public:
-  local_clock(const tz_info* tz);
+  local_clock(tz_database* tz_db, const tz_info& tz);
   bool tick();
   local_time now();
-  void set_tz(const tz_info* tz);
+  time_t get_utc();
+  uint32_t get_phase();
+  uint32_t until_next();
+  void set_tz(const tz_info& tz);
   void sync(const gps_time& time);
+  void sync(const gps_time& time, uint32_t edge_ms);
+  void hold(const gps_time& time, uint32_t uncertainty_ms);
   bool is_sync();
+  bool is_locked();
+  int32_t get_offset();
+  uint32_t get_accuracy();
+  uint32_t get_uncertainty();
+  int32_t get_drift();
+  void set_drift(int32_t drift_ppb);
+  bool take_drift(int32_t& drift_ppb);
+#if defined(USE_TEMPERATURE_SENSOR)
+  void set_temperature(float celsius);
+  void set_table(const drift_table& table);
+  bool take_table(drift_table& table);
+#endif
 
 private:
+  tz_database* tz_db;
+  size_t tz_index;
+  civil_calendar calendar;
   time_t last_time;
-  const tz_info* tz;
+  uint32_t last_phase;
+  time_t base_time;
+  uint32_t base_ms;
+  uint32_t base_ns;
+  int32_t slew_ms;
+  int32_t offset;
+  uint32_t accuracy_ns;
+  uint32_t sync_ms;
+  uint32_t sync_uncertainty_ms;
+  uint32_t reference_ms;
+  bool referenced;
+  time_t anchor_time;
+  uint32_t anchor_ms;
+  int32_t drift_ppb;
+  int32_t applied_ppb;
+  bool calibrated;
+  int32_t saved_ppb;
+  uint32_t saved_ms;
+  bool saved;
+#if defined(USE_TEMPERATURE_SENSOR)
+  drift_table table;
+  float temperature;
+  float temp_sum;
+  float temp_min;
+  float temp_max;
+  uint16_t temp_samples;
+  bool table_changed;
+  uint32_t table_saved_ms;
+  bool table_saved;
+#endif
+
+  time_t utc();
+  time_t to_local(time_t time);
+  uint32_t length(int32_t& slew, uint32_t& ns);
+  void discipline(time_t time, uint32_t start_ms, uint32_t uncertainty_ms, bool reference);
+  void step(time_t time, uint32_t start_ms);
+  void estimate(time_t time, uint32_t start_ms);
+  void anchor(time_t time, uint32_t start_ms);
+  void compensate();
+#if defined(USE_TEMPERATURE_SENSOR)
+  void learn(int32_t measured);
+  static int8_t to_bin(float celsius);
+#endif
+  static time_t to_time(const gps_time& time);
 };
 
 #endif
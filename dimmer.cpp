@@ -16,9 +16,6 @@
 #include "dimmer.h"
 #include "config.h"
 
-// Length of time before taking next photoresistor reading.
-static const uint32_t READING_DELAY_MS = 1000;
-
 // Amount of time that must elapsed when photoresistor reading would trigger a change in brightness level.
 // This is necessary to avoid rapid flickering since photoresistor can produce range of results that would
 // oscillate between adjacent brightness levels.
@@ -35,35 +32,34 @@ light_monitor::light_monitor()
   : pin(DIMMER_PIN),
     cur_reading(PIN_RANGE / 2),
     cur_brightness(to_brightness(cur_reading)),
-    last_reading_time(0),
     last_reading(cur_reading),
     waiting_start(0) {
 }
 
-uint8_t light_monitor::get_brightness() {
-  if (millis() - last_reading_time > READING_DELAY_MS) {
-    // Always keep the latest reading.
-    int value = analogRead(pin);
-    last_reading = value < 0 ? 0 : value < PIN_RANGE ? value : PIN_RANGE;
-    last_reading_time = millis();
+void light_monitor::sample() {
+  // Always keep the latest reading.
+  int value = analogRead(pin);
+  last_reading = value < 0 ? 0 : value < PIN_RANGE ? value : PIN_RANGE;
 
-    if (waiting_start == 0) {
-      // Indicates that wait cycle is not active. Changes in brightness level are recorded only when the
-      // difference in photoresistor pin reading is at least as large as the brightness range. Reasoning
-      // for this behavior is to avoid scenarios where the pin value oscillates back and forth between
-      // brightness range boundaries, which would then result in constant flickering in the display.
-      if (abs(last_reading - cur_reading) >= BRIGHTNESS_RANGE) {
-        waiting_start = millis();
-      }
-    } else {
-      // Indicates wait cycle is active, though commit changes only when wait period expires.
-      if (millis() - waiting_start > WAITING_DELAY_MS) {
-        cur_reading = last_reading;
-        cur_brightness = to_brightness(cur_reading);
-        waiting_start = 0;
-      }
+  if (waiting_start == 0) {
+    // Indicates that wait cycle is not active. Changes in brightness level are recorded only when the
+    // difference in photoresistor pin reading is at least as large as the brightness range. Reasoning
+    // for this behavior is to avoid scenarios where the pin value oscillates back and forth between
+    // brightness range boundaries, which would then result in constant flickering in the display.
+    if (abs(last_reading - cur_reading) >= BRIGHTNESS_RANGE) {
+      waiting_start = millis();
+    }
+  } else {
+    // Indicates wait cycle is active, though commit changes only when wait period expires.
+    if (millis() - waiting_start > WAITING_DELAY_MS) {
+      cur_reading = last_reading;
+      cur_brightness = to_brightness(cur_reading);
+      waiting_start = 0;
     }
   }
+}
+
+uint8_t light_monitor::get_brightness() {
   return cur_brightness;
 }
 
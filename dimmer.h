@@ -18,16 +18,19 @@
 
 #include <Arduino.h>
 
+// Length of time between photoresistor readings.
+static const uint32_t LIGHT_READING_MS = 1000;
+
 class light_monitor {
 public:
   light_monitor();
+  void sample();
   uint8_t get_brightness();
 
 private:
   uint8_t pin;
   uint16_t cur_reading;
   uint8_t cur_brightness;
-  uint32_t last_reading_time;
   uint16_t last_reading;
   uint32_t waiting_start;
 
@@ -23,6 +23,12 @@
 #include "mode.h"
 #include "storage.h"
 #include "dimmer.h"
+#include "pps.h"
+#include "survey.h"
+#include "rtc.h"
+#include "temperature.h"
+#include "scheduler.h"
+#include "pulse.h"
 #include "config.h"
 
 static local_storage* storage;
@@ -34,51 +40,216 @@ static mode_selector* mode_sel;
 static gps_display* gps_disp;
 static clock_display* clock_disp;
 static light_monitor* light_mon;
+#if defined(PPS_PIN)
+static pps_monitor* pps;
+#endif
+#if defined(USE_SURVEY)
+static position_survey* survey;
+#endif
+#if defined(USE_RTC)
+static rtc_clock* rtc;
+#endif
+#if defined(USE_TEMPERATURE_SENSOR)
+static temp_monitor* temp_mon;
+#endif
+#if defined(PULSE_PIN) || defined(PULSE_LOCK_PIN)
+static pulse_generator* pulse;
+#endif
+static task_scheduler* sched;
 
 // Time of last TZ selector movement or 0 if LCD display is turned off.
 static uint32_t last_movement;
 
-void setup() {
-  // Fetch state from persistent storage.
-  storage = new local_storage();
-  local_state state = storage->read();
+// Indicates whether position has been saved since startup.
+static bool position_saved;
 
-  // Initialize GPS module.
-  gps = new gps_unit();
+// Priorities of tasks, where the clock display is updated at the start of each second ahead of
+// everything else, and the GPS display is updated in whatever time remains.
+static const uint8_t PRIORITY_CLOCK = 0;
+static const uint8_t PRIORITY_INPUT = 1;
+static const uint8_t PRIORITY_GPS = 2;
+static const uint8_t PRIORITY_RTC = 3;
+static const uint8_t PRIORITY_DISPLAY = 4;
+static const uint8_t PRIORITY_BACKGROUND = 5;
 
-  // Determine local timezone.
-  tz_db = new tz_database();
-  const tz_info* tz = tz_db->find(state.tz_name);
+// Period of tasks that poll the selectors, GPS module and RTC.
+static const uint32_t POLL_MS = 1;
 
-  // Initialize local clock with persisted timezone.
-  lcl_clock = new local_clock(tz);
+// Tasks that are raised by other tasks.
+static uint8_t clock_task;
+static uint8_t display_task;
+static uint8_t boot_task;
 
-  // Initialize timezone selector componnent.
-  tz_sel = new tz_selector(tz_db, tz);
+// Persisted state read at startup, which is released once the last stage of startup has run.
+static local_state* boot_state;
+static uint8_t boot_stage;
 
-  // Initialize 12/24 time selector.
-  mode_sel = new mode_selector();
+// Times at which stages of startup completed, which are shown with diagnostics.
+static boot_stats boot;
 
-  // Initialize GPS display.
-  gps_disp = new gps_display();
-  gps_disp->show_tz(tz_sel->get_tz(), false);
+// Indicates that diagnostics were toggled and whether they are shown in place of GPS information.
+static bool diag_requested;
+static bool diag_showing;
 
-  // Initialize photoresistor-based light monitor.
-  light_mon = new light_monitor();
+// Indicates that the clock display must be refreshed even if the second has not changed, e.g.
+// because the timezone or mode changed.
+static bool clock_refresh;
 
-  // Initialize localized clock display.
-  clock_disp = new clock_display(light_mon->get_brightness(), state.mode);
-  clock_disp->show_unset();
+// Latest information from the GPS module and TZ selector awaiting the GPS display.
+static gps_state gps_pending = gps_ignore;
+static gps_state gps_last = gps_ignore;
+static gps_info gps_pending_info;
+static gps_time gps_pending_time;
+static tz_action tz_pending = tz_idle;
 
-  // Keep LCD backlight initially on when clock is restarted.
-  last_movement = millis();
+// Indicates that the GPS display previews the local time of a proposed timezone, along with the
+// minute shown, which must be redrawn as the minute changes.
+static bool tz_previewing;
+static uint8_t tz_preview_minute;
+
+#if defined(USE_RTC)
+// Number of milliseconds without GPS time after which the clock is held to the RTC, which is far
+// more stable than the board oscillator.
+static const uint32_t RTC_HOLDOVER_MS = 60000;
+
+// Number of milliseconds between synchronizations with the RTC during holdover.
+static const uint32_t RTC_SYNC_MS = 60000;
+
+// Number of milliseconds between synchronizations of the RTC with GPS time, which is frequent
+// enough given that the RTC drifts by only a few milliseconds per hour.
+static const uint32_t RTC_DISCIPLINE_MS = 3600000;
+
+// Uncertainty in milliseconds of time read from the RTC before and after the start of a second
+// has been observed, respectively.
+static const uint32_t RTC_UNALIGNED_MS = 1000;
+static const uint32_t RTC_ALIGNED_MS = 10;
+
+// Time of last synchronization of the clock with GPS time and of the RTC with the clock.
+static uint32_t gps_sync_ms;
+static uint32_t rtc_write_ms;
+static bool gps_synced;
+static bool rtc_written;
+
+// Number of milliseconds after the start of a second within which the RTC may be written.
+static const uint32_t RTC_WRITE_MS = 2;
+
+// Time of last synchronization of the clock with the start of a second observed on the RTC.
+static uint32_t rtc_sync_ms;
+static bool rtc_aligned;
+#endif
+
+static void sync_clock(const gps_time& time) {
+#if defined(PPS_PIN)
+  // Align the second boundary to the PPS edge if one was recently captured.
+  uint32_t edge_ms;
+  if (pps->edge(edge_ms))
+    lcl_clock->sync(time, edge_ms);
+  else
+    lcl_clock->sync(time);
+#else
+  lcl_clock->sync(time);
+#endif
+#if defined(USE_RTC)
+  gps_sync_ms = millis();
+  gps_synced = true;
+#endif
+  sched->raise(clock_task);
 }
 
-void loop() {
+#if defined(USE_RTC)
+static void discipline_rtc() {
+  // The RTC is written at the start of a second since writing restarts its countdown to the next
+  // second, but only while the clock follows GPS time, since during holdover the clock follows the
+  // RTC and would only write back its own error.
+  if (gps_synced && millis() - gps_sync_ms < RTC_HOLDOVER_MS &&
+      (!rtc_written || millis() - rtc_write_ms >= RTC_DISCIPLINE_MS) &&
+      lcl_clock->get_phase() <= RTC_WRITE_MS) {
+    rtc_write_ms = millis();
+    rtc_written = rtc->write(lcl_clock->get_utc());
+  }
+}
+
+static void hold_clock() {
+  // Once GPS time has been absent for a while, the clock is periodically synchronized with the
+  // start of a second observed on the RTC, which requires polling until the seconds register
+  // changes.
+  if (gps_synced && millis() - gps_sync_ms < RTC_HOLDOVER_MS)
+    return;
+  if (rtc_aligned && millis() - rtc_sync_ms < RTC_SYNC_MS)
+    return;
+  gps_time time;
+  if (rtc->edge(time)) {
+    lcl_clock->hold(time, RTC_ALIGNED_MS);
+    rtc_sync_ms = millis();
+    rtc_aligned = true;
+    sched->raise(clock_task);
+  }
+}
+#endif
+
+static void save_drift() {
+  int32_t drift_ppb;
+  if (lcl_clock->take_drift(drift_ppb))
+    storage->write_drift(drift_ppb);
+#if defined(USE_TEMPERATURE_SENSOR)
+  drift_table table;
+  if (lcl_clock->take_table(table))
+    storage->write_table(table);
+#endif
+}
+
+static void save_position(gps_info& info) {
+  // Surveyed position replaces the reported position once available. Otherwise, last known position
+  // is saved once per startup, since storage endures a limited number of writes.
+#if defined(USE_SURVEY)
+  if (survey->add(info)) {
+    storage->write_position(survey->get_position(), lcl_clock->get_utc(), true);
+    gps->set_position(survey->get_position());
+    position_saved = true;
+  }
+  survey->apply(info);
+  if (survey->is_complete())
+    position_saved = true;
+#endif
+  if (!position_saved) {
+    storage->write_position(info, lcl_clock->get_utc(), false);
+    position_saved = true;
+  }
+}
+
+static void run_clock() {
+  // Runs at the start of each second as predicted by the local clock, or sooner if raised because
+  // the clock was synchronized or the display must be refreshed.
+  if (lcl_clock->is_sync() && (lcl_clock->tick() || clock_refresh)) {
+    local_time now = lcl_clock->now();
+    clock_disp->show_now(now);
+    if (diag_showing)
+      sched->raise(display_task);
+    if (tz_previewing && now.minute != tz_preview_minute && tz_pending == tz_idle) {
+      tz_pending = tz_propose;
+      sched->raise(display_task);
+    }
+  }
+  clock_refresh = false;
+#if defined(USE_RTC)
+  discipline_rtc();
+#endif
+  uint32_t next_ms = lcl_clock->until_next();
+#if defined(PULSE_PIN) || defined(PULSE_LOCK_PIN)
+  // Output continues in holdover, which is indicated separately.
+  if (lcl_clock->is_sync()) {
+    pulse->arm(next_ms * 1000);
+    pulse->set_locked(lcl_clock->is_locked());
+  }
+#endif
+  sched->schedule(clock_task, next_ms);
+}
+
+static void run_input() {
   // Read the TZ selector before making updates to the displays since it might result in a change
   // to the timezone.
   tz_action action = tz_sel->read();
-  const tz_info* tz = tz_sel->get_tz();
+  tz_info tz = tz_sel->get_tz();
 
   // Intelligently turn LCD backlight on/off.
   if (action == tz_idle) {
@@ -96,20 +267,34 @@ void loop() {
     last_movement = millis();
   }
 
-  // Possibly update timezone.
-  if (action != tz_idle)
+  // Possibly update timezone, which is reflected on both displays, e.g. rotation of the encoder
+  // will be reflected in an unconfirmed change in the timezone, whereas a push of the encoder
+  // commits the change.
+  if (action == tz_inspect) {
+    // Diagnostics are toggled by pushing the encoder without rotating it.
+    diag_requested = true;
+    sched->raise(display_task);
+  } else if (action != tz_idle) {
     lcl_clock->set_tz(tz);
+    clock_refresh = true;
+    sched->raise(clock_task);
+    tz_pending = action;
+    sched->raise(display_task);
+  }
   if (action == tz_confirm)
-    storage->write_tz(tz->name);
+    storage->write_tz(tz.name);
 
   // Read the 12/24 selector and toggle the current mode if activated, which also requires an
   // immediate refresh of the display so as not to wait until the next tick.
   if (mode_sel->toggled()) {
     clock_mode mode = clock_disp->toggle_mode();
-    clock_disp->show_now(lcl_clock->now());
+    clock_refresh = true;
+    sched->raise(clock_task);
     storage->write_mode(mode);
   }
+}
 
+static void run_gps() {
   // Read the GPS module, which will almost always return `gps_ignore` once a satellite fix has
   // been established.
   gps_info info;
@@ -119,28 +304,283 @@ void loop() {
     case gps_available:
       // Under normal circumstances in which a fix has been established, this only happens roughly
       // every GPS_SYNC_MILLIS. This is a good time to synchronize the clock.
-      gps_disp->show_info(info, time);
-      lcl_clock->sync(time);
+      sync_clock(time);
+      save_drift();
+      save_position(info);
+      break;
+    case gps_time_only:
+      // Time is available before a position fix has been established, which allows the clock to
+      // be synchronized without waiting for the fix.
+      sync_clock(time);
+      break;
+    default:
+      break;
+  }
+
+  // Updates to the GPS display are slow, so they are deferred to a task of lower priority. The
+  // searching state is reported repeatedly but only needs to be shown once.
+  if (state != gps_ignore && !(state == gps_searching && gps_last == gps_searching)) {
+    gps_pending = state;
+    gps_pending_info = info;
+    gps_pending_time = time;
+    sched->raise(display_task);
+  }
+  if (state != gps_ignore)
+    gps_last = state;
+}
+
+#if defined(USE_RTC)
+static void run_rtc() {
+  hold_clock();
+}
+#endif
+
+static diagnostics get_diagnostics() {
+  return diagnostics { boot, gps->get_stats(), sched->get_stats() };
+}
+
+static void run_display() {
+  // Diagnostics replace everything else until the encoder is pushed again or rotated, after which
+  // the latest GPS information and the timezone are shown again.
+  if (diag_requested || (diag_showing && tz_pending != tz_idle)) {
+    diag_showing = diag_requested && !diag_showing;
+    diag_requested = false;
+    if (diag_showing) {
+      tz_previewing = false;
+      tz_pending = tz_idle;
+    } else {
+      gps_disp->hide_diagnostics();
+      gps_pending = gps_last == gps_degraded ? gps_available : gps_last;
+      if (tz_pending == tz_idle)
+        tz_pending = tz_reset;
+    }
+  }
+  if (diag_showing) {
+    gps_pending = gps_ignore;
+    gps_disp->show_diagnostics(get_diagnostics());
+    return;
+  }
+
+  switch (gps_pending) {
+    case gps_available:
+      gps_disp->show_info(gps_pending_info, gps_pending_time);
+      break;
+    case gps_time_only:
+      gps_disp->show_time(gps_pending_time);
+      break;
+    case gps_degraded:
+      // Indicates that GPS information was withheld from the clock due to poor quality, which
+      // leaves the clock free-running until quality improves.
+      gps_disp->show_degraded(gps->get_gate());
       break;
     case gps_searching:
       // Indicates that a satellite fix has not been established by the GPS module.
       gps_disp->show_searching();
       break;
+    default:
+      break;
   }
+  gps_pending = gps_ignore;
 
-  // Any activity from the TZ selector is reflected on the display, e.g. rotation of the encoder
-  // will be reflected in an unconfirmed change in the timezone, whereas a push of the encoder
-  // commits the change.
-  if (action != tz_idle)
-    gps_disp->show_tz(tz, action == tz_propose);
+  if (tz_pending != tz_idle) {
+    // A proposed timezone is previewed with its local time, which the clock has already adopted.
+    tz_previewing = tz_pending == tz_propose && lcl_clock->is_sync();
+    if (tz_previewing) {
+      local_time now = lcl_clock->now();
+      gps_disp->show_preview(tz_sel->get_tz(), now);
+      tz_preview_minute = now.minute;
+    } else
+      gps_disp->show_tz(tz_sel->get_tz(), tz_pending == tz_propose);
+    tz_pending = tz_idle;
+  }
+}
+
+static void run_light() {
+  // Change brightness level of the clock. In most cases, this results in a no-op since the clock
+  // will only adjust brightness if the level actually changed.
+  light_mon->sample();
+  clock_disp->set_brightness(light_mon->get_brightness());
+}
+
+#if defined(USE_TEMPERATURE_SENSOR)
+static void run_temperature() {
+  // Track temperature of the board, which changes the frequency of its oscillator.
+  lcl_clock->set_temperature(temp_mon->read());
+}
+#endif
+
+static void boot_display() {
+  // Initialize GPS display, which is slow due to definition of custom characters, along with the
+  // timezone selector whose changes it shows.
+  gps_disp = new gps_display();
+  tz_sel = new tz_selector(tz_db, tz_db->find(boot_state->tz_name));
+  gps_disp->show_tz(tz_sel->get_tz(), false);
+
+  // Keep LCD backlight initially on when clock is restarted.
+  last_movement = millis();
+
+  sched->add(run_input, PRIORITY_INPUT, POLL_MS);
+  display_task = sched->add(run_display, PRIORITY_DISPLAY, TASK_EVENT);
+}
+
+static void boot_gps() {
+  // Initialize GPS module, starting with the baud rate detected on a prior boot.
+#if defined(USE_BAUD_DETECT)
+  gps = new gps_unit(boot_state->gps_baud_rate);
+#else
+  gps = new gps_unit(GPS_BAUD_RATE);
+#endif
+
+#if defined(USE_SURVEY)
+  // Resume with surveyed position if one was previously persisted, otherwise start a new survey.
+  if (boot_state->surveyed)
+    survey = new position_survey(boot_state->position);
+  else
+    survey = new position_survey();
+#endif
+
+#if defined(PPS_PIN)
+  // Initialize optional PPS signal from GPS module.
+  pps = new pps_monitor();
+#endif
+}
+
+static bool detect_gps() {
+#if defined(USE_BAUD_DETECT)
+  // Listen for the GPS module at each candidate baud rate in turn, which may take several seconds
+  // if the rate differs from that detected on a prior boot.
+  if (!gps->detect())
+    return false;
+  if (gps->get_baud_rate() != boot_state->gps_baud_rate)
+    storage->write_gps_baud_rate(gps->get_baud_rate());
+#endif
+
+  // Configuration of the module is carried out by the GPS task as it reads.
+  gps->configure();
+  sched->add(run_gps, PRIORITY_GPS, POLL_MS);
+  return true;
+}
+
+static void aid_gps() {
+#if defined(USE_SURVEY)
+  // Hold the module to the surveyed position if one was previously persisted.
+  if (boot_state->surveyed)
+    gps->set_position(boot_state->position);
+#endif
 
-  // If the local clock has changed since the last tick or a timezone was changed, then update
-  // the display.
-  if (lcl_clock->is_sync() && (lcl_clock->tick() || action != tz_idle))
+  // Warm start GPS module with last known position, along with the current time if known from the
+  // RTC, or otherwise the time at which the position was saved.
+  if (boot_state->positioned)
+    gps->aid(boot_state->position, lcl_clock->is_sync() ? lcl_clock->get_utc() : boot_state->position_time);
+}
+
+static void run_boot() {
+  // Completes startup one stage per run, in between updates of the clock display. Stages that wait
+  // on the GPS module poll once per run and return rather than block, so no run is long enough to
+  // delay the clock.
+  bool done = true;
+  switch (boot_stage) {
+    case 0:
+      boot_display();
+      boot.display_ms = millis();
+      break;
+    case 1:
+      boot_gps();
+      break;
+    case 2:
+      done = detect_gps();
+      break;
+    case 3:
+      done = !gps->is_busy();
+      if (done)
+        aid_gps();
+      break;
+    case 4:
+      done = !gps->is_busy();
+      if (done) {
+        boot.gps_ms = millis();
+        gps->start_ttff();
+        delete boot_state;
+        boot_state = nullptr;
+      }
+      break;
+    default:
+      return;
+  }
+  if (done) {
+    ++boot_stage;
+    sched->raise(boot_task);
+  } else
+    sched->schedule(boot_task, POLL_MS);
+}
+
+void setup() {
+  // Fetch state from persistent storage, which is retained until deferred stages of startup have
+  // consumed it.
+  storage = new local_storage();
+  boot_state = new local_state(storage->read());
+
+  // Initialize photoresistor-based light monitor.
+  light_mon = new light_monitor();
+
+  // Initialize localized clock display, which shows dashes before anything else so that the
+  // clock is visibly alive as soon as possible.
+  clock_disp = new clock_display(light_mon->get_brightness(), boot_state->mode);
+  clock_disp->show_unset();
+  boot.first_frame_ms = millis();
+
+  // Determine local timezone.
+  tz_db = new tz_database();
+  tz_info tz = tz_db->find(boot_state->tz_name);
+
+  // Initialize local clock with persisted timezone and oscillator drift.
+  lcl_clock = new local_clock(tz_db, tz);
+  if (boot_state->calibrated)
+    lcl_clock->set_drift(boot_state->drift_ppb);
+#if defined(USE_TEMPERATURE_SENSOR)
+  // Oscillator drift is also compensated for temperature using the on-chip sensor.
+  temp_mon = new temp_monitor();
+  if (boot_state->compensated)
+    lcl_clock->set_table(boot_state->table);
+#endif
+
+#if defined(USE_RTC)
+  // Start the clock from the optional RTC so the time is shown immediately, even though the start
+  // of the second is not known until the RTC is observed to change.
+  rtc = new rtc_clock();
+  gps_time rtc_time;
+  if (rtc->read(rtc_time))
+    lcl_clock->hold(rtc_time, RTC_UNALIGNED_MS);
+#endif
+  if (lcl_clock->tick())
     clock_disp->show_now(lcl_clock->now());
+  boot.clock_ms = millis();
 
-  // Change brightness level of the clock. In most cases, this results in a no-op since the light
-  // monitor samples on a periodic basis and the clock will only adjust brightness if the level
-  // actually changed.
-  clock_disp->set_brightness(light_mon->get_brightness());
+  // Initialize 12/24 time selector.
+  mode_sel = new mode_selector();
+
+#if defined(PULSE_PIN) || defined(PULSE_LOCK_PIN)
+  // Initialize optional output of pulses from local clock.
+  pulse = new pulse_generator();
+#endif
+
+  // Register tasks that depend only on the clock, where the clock task schedules itself at the
+  // start of each second. Remaining tasks are registered by the boot task once the components on
+  // which they depend are initialized.
+  sched = new task_scheduler();
+  clock_task = sched->add(run_clock, PRIORITY_CLOCK, TASK_EVENT);
+#if defined(USE_RTC)
+  sched->add(run_rtc, PRIORITY_RTC, POLL_MS);
+#endif
+  sched->add(run_light, PRIORITY_BACKGROUND, LIGHT_READING_MS);
+#if defined(USE_TEMPERATURE_SENSOR)
+  sched->add(run_temperature, PRIORITY_BACKGROUND, TEMP_READING_MS);
+#endif
+  boot_task = sched->add(run_boot, PRIORITY_BACKGROUND, TASK_EVENT);
+  sched->raise(clock_task);
+  sched->raise(boot_task);
+}
+
+void loop() {
+  sched->run();
 }
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 #include "gps.h"
+#include "civil.h"
+#include "gpsmodule.h"
 #include "config.h"
 
 // Number of milliseconds that must elapse before returning new GPS information.
@@ -23,40 +25,556 @@ static const uint32_t SYNC_DELAY_MS = 2000;
 // the GPS module is searching.
 static const uint32_t SEARCHING_DELAY_MS = 30000;
 
-#if defined(USE_SOFTWARE_SERIAL)
+#if defined(USE_SOFTWARE_SERIAL) || defined(USE_CAPTURE_SERIAL)
 #define SERIAL ser
 #else
 #define SERIAL Serial1
 #endif
 
-gps_unit::gps_unit()
-  : last_sync(0)
+// Maximum age of fix quality and HDOP, beyond which the module is presumed to have stopped
+// reporting a fix even if it continues to emit time.
+static const uint32_t QUALITY_AGE_MS = 3 * static_cast<uint32_t>(GPS_UPDATE_MS);
+
+// Maximum difference in seconds between GPS time and time projected from the last accepted
+// synchronization before GPS time is considered inconsistent.
+static const int32_t MAX_JUMP_S = 1;
+
+// Number of consecutive inconsistent times that must be observed before accepting them, which
+// allows the clock to recover from a genuine discontinuity, e.g. a bad initial fix.
+static const uint8_t JUMP_CONFIRMATIONS = 3;
+
+// Number of consecutive sentences whose time advances in step with elapsed time before time is
+// trusted in the absence of a position fix.
+static const uint8_t TIME_CONFIRMATIONS = 3;
+
+// Year in which the firmware was built, before which GPS time is certainly wrong, e.g. when a
+// module without a backup battery reports time from its default epoch.
+static const uint16_t BUILD_YEAR =
+  (__DATE__[7] - '0') * 1000 + (__DATE__[8] - '0') * 100 + (__DATE__[9] - '0') * 10 + (__DATE__[10] - '0');
+
+#if defined(USE_BAUD_DETECT)
+// Standard baud rates of GPS modules in the order in which they are probed.
+static const long BAUD_RATES[] = { 9600, 4800, 38400, 57600, 115200, 19200 };
+static const uint8_t BAUD_RATE_COUNT = sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]);
+
+// Number of milliseconds spent listening at a given baud rate, which must be long enough to
+// receive a complete second of sentences from a module reporting once per second, even when the
+// listening starts just after the module began sending and its default sentences take most of a
+// second to send at 4800 baud.
+static const uint32_t PROBE_MS = 2000;
+
+// Number of sentences with valid checksums required to lock on to a baud rate. Bytes received at
+// the wrong rate are very unlikely to produce even a single valid sentence.
+static const uint32_t PROBE_SENTENCES = 2;
+
+static bool is_standard(long baud_rate) {
+  for (uint8_t i = 0; i < BAUD_RATE_COUNT; ++i) {
+    if (BAUD_RATES[i] == baud_rate)
+      return true;
+  }
+  return false;
+}
+#endif
+
+// Accuracy in milliseconds claimed for time used to aid the GPS module, which is only known to be
+// no earlier than the time at which the position was saved.
+static const uint32_t AIDING_ACCURACY_MS = 3600000;
+
+#if !defined(GPS_MODULE_NONE)
+// Number of attempts made to send a command before giving up.
+static const uint8_t SEND_ATTEMPTS = 3;
+
+// Number of milliseconds allowed for a command that reconfigures the port of the module to be
+// transmitted and take effect, since the module does not acknowledge it.
+static const uint32_t SETTLE_MS = 100;
+
+// Jobs that may be queued, which are carried out in this order.
+static const uint8_t JOB_CONFIGURE = 0x01;
+static const uint8_t JOB_POSITION = 0x02;
+static const uint8_t JOB_AID = 0x04;
+#endif
+
+// Number of bits transmitted per byte, which includes start and stop bits.
+static const uint32_t BITS_PER_BYTE = 10;
+
+// Upper bounds of all but the last bucket in histogram of time spent per call to read().
+static const uint32_t LATENCY_BOUNDS_US[GPS_LATENCY_BUCKETS - 1] = { 100, 250, 500, 1000 };
+
+// Capacity of the receive buffer of the serial interface, which is only needed to infer overflows
+// when the interface does not report them directly.
 #if defined(USE_SOFTWARE_SERIAL)
-    , ser(GPS_TX_PIN, GPS_RX_PIN)
+static const uint16_t SERIAL_CAPACITY = _SS_MAX_RX_BUFF - 1;
+#elif defined(SERIAL_RX_BUFFER_SIZE)
+static const uint16_t SERIAL_CAPACITY = SERIAL_RX_BUFFER_SIZE - 1;
+#elif defined(SERIAL_BUFFER_SIZE)
+static const uint16_t SERIAL_CAPACITY = SERIAL_BUFFER_SIZE - 1;
+#else
+static const uint16_t SERIAL_CAPACITY = 63;
+#endif
+
+gps_unit::gps_unit(long baud_rate)
+  :
+#if defined(USE_SOFTWARE_SERIAL) || defined(USE_CAPTURE_SERIAL)
+    ser(GPS_TX_PIN, GPS_RX_PIN),
+#endif
+#if !defined(GPS_MODULE_NONE)
+    module(SERIAL),
+#endif
+    baud_rate(baud_rate),
+    last_sync(0),
+    configured(false),
+    byte_us(0),
+    mark_us(0),
+    time_mark_us(0),
+    stats {},
+    searching(false),
+    gate(gate_ok),
+    last_time(0),
+    last_time_ms(0),
+    jumps(0),
+    steady_time(0),
+    steady_ms(0),
+    steady(0),
+    fixed(false),
+    ttff_start_ms(0),
+    timing_ttff(false)
+#if defined(USE_BAUD_DETECT)
+    , detecting(true),
+    candidate(0),
+    probe_rate(0),
+    probe_ms(0),
+    probe_sentences(0),
+    detect_ms(millis())
+#endif
+#if !defined(GPS_MODULE_NONE)
+    , jobs(0),
+    step(step_idle),
+    index(0),
+    attempts(0),
+    settling(false),
+    sent_ms(0),
+    fixed_position {},
+    aid_position {},
+    aid_time(0)
 #endif
 {
-  SERIAL.begin(GPS_BAUD_RATE);
+#if defined(USE_BAUD_DETECT)
+  probe();
+#else
+  begin(baud_rate);
+#endif
 }
 
 gps_state gps_unit::read(gps_info& info, gps_time& time) {
-  while (SERIAL.available()) {
-    if (gps.encode(SERIAL.read()) && millis() - last_sync > SYNC_DELAY_MS) {
-      if (get_info(gps, info) && get_time(gps, time)) {
-        last_sync = millis();
-        return gps_available;
+#if !defined(GPS_MODULE_NONE)
+  service();
+#endif
+
+  // Bytes are consumed under a budget so that a burst from the GPS module cannot delay the rest of
+  // the loop. Anything left over stays in the receive buffer until the next call.
+  uint16_t count = SERIAL.available();
+#if !defined(USE_CAPTURE_SERIAL)
+  if (count > stats.high_water)
+    stats.high_water = count;
+#if defined(USE_SOFTWARE_SERIAL)
+  if (SERIAL.overflow())
+    ++stats.overflows;
+#else
+  if (count >= SERIAL_CAPACITY)
+    ++stats.overflows;
+#endif
+#endif
+  if (count > GPS_BUDGET_BYTES)
+    count = GPS_BUDGET_BYTES;
+
+  uint32_t start = micros();
+  for (; count > 0 && micros() - start < GPS_BUDGET_US; --count) {
+    char c = SERIAL.read();
+    ++stats.bytes;
+#if !defined(GPS_MODULE_NONE)
+    module.encode(c);
+#endif
+    if (gps.is_start(c)) {
+      // Bytes still waiting in the receive buffer arrived after this one, so work backwards to
+      // estimate when its start bit appeared on the wire.
+      mark_us = micros() - (SERIAL.available() + 1) * byte_us;
+    }
+    if (gps.encode(c)) {
+      // Only sentences that carry both date and time are used to label the second, and only then
+      // is the timestamp of the sentence meaningful.
+      if (gps.has_time()) {
+        time_mark_us = mark_us;
+        const gps_fix& fix = gps.get_fix();
+        if (get_time(fix, time)) {
+          time.start_ms = start_of_second(time.nano);
+          bool trusted = trust(time);
+          if (millis() - last_sync > SYNC_DELAY_MS) {
+            if (get_info(fix, info)) {
+              gate = check(fix, time);
+              if (gate != gate_ok) {
+                ++stats.dropped;
+                return record(gps_degraded, start);
+              }
+              accept(time);
+              fixed = true;
+              if (timing_ttff) {
+                stats.ttff_ms = millis() - ttff_start_ms;
+                timing_ttff = false;
+              }
+              return record(gps_available, start);
+            } else if (trusted && !fixed) {
+              // Modules usually resolve time well before position, so the clock need not wait
+              // for the first position fix. Once a fix is established, only the position path
+              // is allowed to synchronize the clock.
+              accept(time);
+              return record(gps_time_only, start);
+            }
+          }
+        }
       }
     }
   }
-  return millis() - last_sync > SEARCHING_DELAY_MS ? gps_searching : gps_ignore;
+  return record(millis() - last_sync > SEARCHING_DELAY_MS ? gps_searching : gps_ignore, start);
+}
+
+#if defined(USE_BAUD_DETECT)
+bool gps_unit::detect() {
+  // Listens at the candidate baud rate for long enough to receive a few sentences, consuming only
+  // those bytes already received on each call, and moves on to the next candidate when none
+  // arrive. Returns true once a rate is locked, falling back to the configured rate if none is.
+  if (!detecting)
+    return true;
+  uint16_t count = SERIAL.available();
+  if (count > GPS_BUDGET_BYTES)
+    count = GPS_BUDGET_BYTES;
+  for (; count > 0; --count) {
+    gps.encode(SERIAL.read());
+    if (gps.get_sentences() - probe_sentences >= PROBE_SENTENCES)
+      return lock(probe_rate);
+  }
+  if (millis() - probe_ms >= PROBE_MS && !probe())
+    return lock(GPS_BAUD_RATE);
+  return false;
+}
+
+bool gps_unit::probe() {
+  // Baud rate detected on a prior boot is probed first, which is almost always correct, followed
+  // by the remaining standard rates. Returns false once every candidate has been probed.
+  while (candidate <= BAUD_RATE_COUNT) {
+    uint8_t i = candidate++;
+    long rate = i == 0 ? baud_rate : BAUD_RATES[i - 1];
+    if (i == 0 ? is_standard(rate) : rate != baud_rate) {
+      probe_rate = rate;
+      begin(rate);
+#if defined(GPS_PROTOCOL_UBX)
+      // Module may not yet be emitting UBX messages, so a response is solicited instead.
+      module.poll_port();
+#endif
+      probe_sentences = gps.get_sentences();
+      probe_ms = millis();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool gps_unit::lock(long baud_rate) {
+  if (baud_rate != probe_rate)
+    begin(baud_rate);
+  this->baud_rate = baud_rate;
+  detecting = false;
+  stats.detect_ms = millis() - detect_ms;
+  return true;
+}
+#endif
+
+void gps_unit::begin(long baud_rate) {
+  SERIAL.begin(baud_rate);
+  byte_us = BITS_PER_BYTE * 1000000 / baud_rate;
 }
 
-bool gps_unit::get_info(TinyGPSPlus& gps, gps_info& info) {
-  if (gps.location.isValid() && gps.satellites.isValid() && gps.altitude.isValid()) {
+gps_state gps_unit::record(gps_state state, uint32_t start_us) {
+  uint32_t elapsed = micros() - start_us;
+  uint8_t bucket = 0;
+  while (bucket < GPS_LATENCY_BUCKETS - 1 && elapsed >= LATENCY_BOUNDS_US[bucket])
+    ++bucket;
+  if (stats.latency[bucket] < UINT16_MAX)
+    ++stats.latency[bucket];
+
+  // Transitions between searching and available indicate loss and reacquisition of a fix.
+  if (state == gps_searching && !searching) {
+    searching = true;
+    ++stats.losses;
+  } else if (state == gps_available && searching) {
+    searching = false;
+    ++stats.acquisitions;
+  }
+  return state;
+}
+
+uint32_t gps_unit::start_of_second(int32_t nano) {
+  // The second began some time before the sentence was emitted by the module, which is only known
+  // approximately for a given type of module. Time may also refer to an instant within the second
+  // when the module reports more than once per second.
+  uint32_t age_ms = (micros() - time_mark_us) / 1000 + GPS_LATENCY_MS;
+  return millis() - age_ms - nano / 1000000;
+}
+
+gps_gate gps_unit::check(const gps_fix& fix, const gps_time& time) {
+  // The module may continue emitting time after losing its fix, so the most recent sentences must
+  // report a fix whose quality was decoded recently enough to be trusted.
+  if (!fix.active)
+    return gate_no_fix;
+  if (!(fix.valid & FIX_QUALITY) || millis() - fix.quality_ms > QUALITY_AGE_MS)
+    return gate_stale;
+  if (fix.hdop > GPS_MAX_HDOP)
+    return gate_hdop;
+
+  // Time must agree with the last accepted time projected forward by elapsed time, unless the
+  // disagreement persists long enough to be believed.
+  if (last_time != 0) {
+    time_t expected = last_time + (time.start_ms - last_time_ms + 500) / 1000;
+    int32_t jump = static_cast<int32_t>(to_time(time) - expected);
+    if ((jump > MAX_JUMP_S || jump < -MAX_JUMP_S) && ++jumps < JUMP_CONFIRMATIONS)
+      return gate_inconsistent;
+  }
+  return gate_ok;
+}
+
+bool gps_unit::trust(const gps_time& time) {
+  // Time is trusted without a position fix only if it is plausible and has advanced in step with
+  // elapsed time across several consecutive sentences.
+  time_t t = to_time(time);
+  time_t expected = steady_time + (time.start_ms - steady_ms + 500) / 1000;
+  if (steady_time != 0 && t == expected) {
+    if (steady < TIME_CONFIRMATIONS)
+      ++steady;
+  } else {
+    steady = 0;
+  }
+  steady_time = t;
+  steady_ms = time.start_ms;
+  return steady >= TIME_CONFIRMATIONS && time.year >= BUILD_YEAR;
+}
+
+void gps_unit::accept(const gps_time& time) {
+  jumps = 0;
+  last_time = to_time(time);
+  last_time_ms = time.start_ms;
+  last_sync = millis();
+}
+
+#if defined(GPS_MODULE_NONE)
+void gps_unit::set_position(const gps_info&) {
+}
+
+void gps_unit::aid(const gps_info&, time_t) {
+}
+
+void gps_unit::configure() {
+}
+#else
+void gps_unit::set_position(const gps_info& position) {
+  fixed_position = position;
+  jobs |= JOB_POSITION;
+}
+
+void gps_unit::aid(const gps_info& position, time_t time) {
+  aid_position = position;
+  aid_time = time;
+  jobs |= JOB_AID;
+}
+#endif
+
+long gps_unit::get_baud_rate() {
+  return baud_rate;
+}
+
+gps_gate gps_unit::get_gate() {
+  return gate;
+}
+
+bool gps_unit::is_configured() {
+  return configured;
+}
+
+bool gps_unit::is_busy() {
+#if defined(GPS_MODULE_NONE)
+  return false;
+#else
+  return jobs != 0 || step != step_idle;
+#endif
+}
+
+#if !defined(GPS_MODULE_NONE)
+void gps_unit::configure() {
+  // Limiting the module to those sentences actually decoded eliminates most of the bytes that
+  // would otherwise be received and discarded.
+  jobs |= JOB_CONFIGURE;
+}
+
+void gps_unit::service() {
+  // Waits for the command in flight to be acknowledged, rejected or timed out, or for the port to
+  // settle after being reconfigured. Rejected commands are retried a few times before moving on.
+  if (step != step_idle) {
+    gps_ack ack = module.get_ack();
+    if (ack == ack_pending || (settling && millis() - sent_ms < SETTLE_MS))
+      return;
+    bool ok = ack != ack_rejected && ack != ack_timeout;
+    if (!ok && ++attempts < SEND_ATTEMPTS) {
+      send();
+      return;
+    }
+    complete(ok);
+  }
+
+  // Sends the next command, skipping steps that have nothing to send.
+  while (step != step_idle || next_job()) {
+    if (send())
+      return;
+    next_step();
+  }
+}
+
+bool gps_unit::next_job() {
+  if (jobs & JOB_CONFIGURE) {
+    jobs &= ~JOB_CONFIGURE;
+    step = step_port;
+    configured = true;
+  } else if (jobs & JOB_POSITION) {
+    jobs &= ~JOB_POSITION;
+    step = step_position;
+  } else if (jobs & JOB_AID) {
+    jobs &= ~JOB_AID;
+    step = step_aid;
+  } else {
+    return false;
+  }
+  index = 0;
+  attempts = 0;
+  return true;
+}
+
+void gps_unit::next_step() {
+  // Configuration proceeds through its steps in order, whereas other jobs have a single step.
+  step = step >= step_port && step < step_verify ? static_cast<command_step>(step + 1) : step_idle;
+  index = 0;
+  attempts = 0;
+}
+
+bool gps_unit::send() {
+  // Sends the command at the current index of the current step, returning false if there is none.
+  settling = false;
+  switch (step) {
+#if defined(GPS_PROTOCOL_UBX)
+    case step_port:
+      // Module only emits NMEA by default, so UBX output must be enabled on the port, which is
+      // reconfigured at the same baud rate and therefore not acknowledged.
+      if (index > 0)
+        return false;
+      module.set_baud_rate(baud_rate);
+      settling = true;
+      break;
+#endif
+    case step_sentences:
+      if (!module.set_sentences(index))
+        return false;
+      break;
+    case step_rate:
+      if (index > 0)
+        return false;
+      module.set_update_rate(GPS_UPDATE_MS);
+      break;
+    case step_baud:
+      // Module does not acknowledge a change in baud rate, so verification is done by resending a
+      // command at the new rate.
+      if (index > 0 || GPS_MODULE_BAUD_RATE == baud_rate)
+        return false;
+      module.set_baud_rate(GPS_MODULE_BAUD_RATE);
+      settling = true;
+      break;
+    case step_verify:
+      if (index > 0 || GPS_MODULE_BAUD_RATE == baud_rate)
+        return false;
+      module.set_update_rate(GPS_UPDATE_MS);
+      break;
+    case step_position:
+      if (!module.set_position(index, fixed_position.lat, fixed_position.lon, fixed_position.altitude))
+        return false;
+      break;
+    case step_aid:
+      if (index > 0)
+        return false;
+      module.set_aiding(aid_position.lat, aid_position.lon, aid_position.altitude,
+        from_epoch(aid_time), AIDING_ACCURACY_MS);
+      break;
+    default:
+      return false;
+  }
+  sent_ms = millis();
+  return true;
+}
+
+void gps_unit::complete(bool ok) {
+  attempts = 0;
+  switch (step) {
+    case step_sentences:
+    case step_rate:
+      configured = configured && ok;
+      ++index;
+      break;
+    case step_baud:
+      begin(GPS_MODULE_BAUD_RATE);
+      ++index;
+      break;
+    case step_verify:
+      // Revert to the original rate if the module cannot be reached at the new rate.
+      if (!ok) {
+        begin(baud_rate);
+        configured = false;
+      }
+      ++index;
+      break;
+    case step_position:
+      // Commands are alternatives, so the first to be accepted completes the step.
+      if (ok)
+        next_step();
+      else
+        ++index;
+      break;
+    default:
+      ++index;
+      break;
+  }
+}
+#endif
+
+// Starts measuring time to first fix, which should be called once the module is configured and
+// aided, so that time spent on startup of the clock itself is not counted.
+void gps_unit::start_ttff() {
+  ttff_start_ms = millis();
+  timing_ttff = true;
+}
+
+gps_stats gps_unit::get_stats() {
+#if defined(USE_CAPTURE_SERIAL)
+  const ring_buffer& buffer = SERIAL.get_buffer();
+  stats.high_water = buffer.get_high_water();
+  stats.overflows = buffer.get_overflows();
+#endif
+  stats.sentences = gps.get_sentences();
+  stats.checksum_errors = gps.get_checksum_errors();
+  return stats;
+}
+
+bool gps_unit::get_info(const gps_fix& fix, gps_info& info) {
+  static const uint8_t REQUIRED = FIX_LOCATION | FIX_ALTITUDE | FIX_SATELLITES;
+  if ((fix.valid & REQUIRED) == REQUIRED) {
     info = gps_info {
-      static_cast<float>(gps.location.lat()),
-      static_cast<float>(gps.location.lng()),
-      static_cast<float>(gps.altitude.meters()),
-      static_cast<uint8_t>(gps.satellites.value())
+      fix.lat,
+      fix.lon,
+      fix.altitude,
+      fix.satellites
     };
     return true;
   } else {
@@ -64,11 +582,19 @@ bool gps_unit::get_info(TinyGPSPlus& gps, gps_info& info) {
   }
 }
 
-bool gps_unit::get_time(TinyGPSPlus& gps, gps_time& time) {
-  if (gps.date.isValid() && gps.time.isValid()) {
+time_t gps_unit::to_time(const gps_time& time) {
+  return to_epoch(time.year, time.month, time.day, time.hour, time.minute, time.second);
+}
+
+bool gps_unit::get_time(const gps_fix& fix, gps_time& time) {
+  static const uint8_t REQUIRED = FIX_DATE | FIX_TIME;
+  if ((fix.valid & REQUIRED) == REQUIRED) {
     time = gps_time {
-      gps.date.year(), gps.date.month(), gps.date.day(),
-      gps.time.hour(), gps.time.minute(), gps.time.second()
+      fix.year, fix.month, fix.day,
+      fix.hour, fix.minute, fix.second,
+      fix.nano,
+      fix.accuracy_ns,
+      0
     };
     return true;
   } else {
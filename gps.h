@@ -17,11 +17,25 @@
 #define __GPS_H
 
 #include <Arduino.h>
-#include <TinyGPSPlus.h>
+#include <TimeLib.h>
 #include "board.h"
+#include "config.h"
+#include "gpsfix.h"
+#include "gpsmodule.h"
+#if defined(GPS_PROTOCOL_UBX)
+#include "ubx.h"
+#else
+#include "nmea.h"
+#endif
+
+#if defined(GPS_PROTOCOL_UBX) && !defined(GPS_MODULE_UBLOX)
+#error "UBX protocol requires CONFIG_GPS_MODULE=UBLOX"
+#endif
 
 #if defined(USE_SOFTWARE_SERIAL)
 #include <SoftwareSerial.h>
+#elif defined(USE_CAPTURE_SERIAL)
+#include "captureserial.h"
 #endif
 
 struct gps_info {
@@ -38,28 +52,154 @@ struct gps_time {
   uint8_t hour;
   uint8_t minute;
   uint8_t second;
+  int32_t nano;
+  uint32_t accuracy_ns;
+  uint32_t start_ms;
+};
+
+// Number of buckets in histogram of time spent per call to `gps_unit::read()`, where upper bounds
+// of buckets are 100 us, 250 us, 500 us, 1 ms and unbounded.
+static const uint8_t GPS_LATENCY_BUCKETS = 5;
+
+struct gps_stats {
+  uint16_t high_water;
+  uint16_t overflows;
+  uint32_t bytes;
+  uint32_t sentences;
+  uint16_t checksum_errors;
+  uint16_t acquisitions;
+  uint16_t losses;
+  uint16_t dropped;
+  uint16_t detect_ms;
+  uint32_t ttff_ms;
+  uint16_t latency[GPS_LATENCY_BUCKETS];
 };
 
 enum gps_state {
   gps_searching,
   gps_available,
+  gps_time_only,
+  gps_degraded,
   gps_ignore
 };
 
+// Reason that GPS information was most recently withheld from synchronization, which is only
+// meaningful when `gps_unit::read()` returns `gps_degraded`.
+enum gps_gate {
+  gate_ok,
+  gate_no_fix,
+  gate_stale,
+  gate_hdop,
+  gate_inconsistent
+};
+
+// Reads time and position from the GPS module. Commands sent to the module, e.g. to configure it
+// at startup or to hold a surveyed position, are queued and carried out a step at a time by
+// `read()`, which also recognizes their acknowledgements among the bytes it consumes, so the
+// clock is never kept waiting on the module. Likewise, detection of the baud rate proceeds a
+// little on each call to `detect()`, which must return true before `read()` is first called.
 class gps_unit {
 public:
-  gps_unit();
+  gps_unit(long baud_rate);
+#if defined(USE_BAUD_DETECT)
+  bool detect();
+#endif
   gps_state read(gps_info& info, gps_time& time);
+  gps_stats get_stats();
+  gps_gate get_gate();
+  long get_baud_rate();
+  void set_position(const gps_info& position);
+  void aid(const gps_info& position, time_t time);
+  void configure();
+  bool is_configured();
+  bool is_busy();
+  void start_ttff();
 
 private:
+  // Steps through which queued commands proceed, where configuration consists of all steps from
+  // `step_port` through `step_verify`.
+  enum command_step {
+    step_idle,
+    step_port,
+    step_sentences,
+    step_rate,
+    step_baud,
+    step_verify,
+    step_position,
+    step_aid
+  };
+
 #if defined(USE_SOFTWARE_SERIAL)
   SoftwareSerial ser;
+#elif defined(USE_CAPTURE_SERIAL)
+  capture_serial ser;
+#endif
+#if !defined(GPS_MODULE_NONE)
+  gps_module module;
+#endif
+#if defined(GPS_PROTOCOL_UBX)
+  ubx_parser gps;
+#else
+  nmea_parser gps;
 #endif
-  TinyGPSPlus gps;
+  long baud_rate;
   uint32_t last_sync;
+  bool configured;
+  uint32_t byte_us;
+  uint32_t mark_us;
+  uint32_t time_mark_us;
+  gps_stats stats;
+  bool searching;
+  gps_gate gate;
+  time_t last_time;
+  uint32_t last_time_ms;
+  uint8_t jumps;
+  time_t steady_time;
+  uint32_t steady_ms;
+  uint8_t steady;
+  bool fixed;
+  uint32_t ttff_start_ms;
+  bool timing_ttff;
+#if defined(USE_BAUD_DETECT)
+  bool detecting;
+  uint8_t candidate;
+  long probe_rate;
+  uint32_t probe_ms;
+  uint32_t probe_sentences;
+  uint32_t detect_ms;
+#endif
+#if !defined(GPS_MODULE_NONE)
+  uint8_t jobs;
+  command_step step;
+  uint8_t index;
+  uint8_t attempts;
+  bool settling;
+  uint32_t sent_ms;
+  gps_info fixed_position;
+  gps_info aid_position;
+  time_t aid_time;
+#endif
 
-  static bool get_info(TinyGPSPlus& gps, gps_info& info);
-  static bool get_time(TinyGPSPlus& gps, gps_time& time);
+  void begin(long baud_rate);
+#if defined(USE_BAUD_DETECT)
+  bool probe();
+  bool lock(long baud_rate);
+#endif
+  gps_state record(gps_state state, uint32_t start_us);
+  uint32_t start_of_second(int32_t nano);
+  gps_gate check(const gps_fix& fix, const gps_time& time);
+  bool trust(const gps_time& time);
+  void accept(const gps_time& time);
+#if !defined(GPS_MODULE_NONE)
+  void service();
+  bool next_job();
+  void next_step();
+  bool send();
+  void complete(bool ok);
+#endif
+  static bool get_info(const gps_fix& fix, gps_info& info);
+  static bool get_time(const gps_fix& fix, gps_time& time);
+  static time_t to_time(const gps_time& time);
 };
 
 #endif
@@ -243,6 +243,8 @@ static const uint8_t ROW_ALTITUDE = 1;
 static const uint8_t COL_ALTITUDE = 0;
 static const uint8_t ROW_SATELLITE = 1;
 static const uint8_t COL_SATELLITE = 13;
+static const uint8_t ROW_GATE = 1;
+static const uint8_t COL_GATE = 10;
 static const uint8_t ROW_UTC = 2;
 static const uint8_t COL_UTC = 0;
 static const uint8_t ROW_TZ = 3;
@@ -259,6 +261,8 @@ static const uint8_t ROW_ALTITUDE = 2;
 static const uint8_t COL_ALTITUDE = 0;
 static const uint8_t ROW_SATELLITE = 3;
 static const uint8_t COL_SATELLITE = 0;
+static const uint8_t ROW_GATE = 3;
+static const uint8_t COL_GATE = 6;
 static const uint8_t ROW_UTC = 4;
 static const uint8_t COL_UTC = 0;
 static const uint8_t ROW_TZ = 6;
@@ -274,12 +278,24 @@ static const uint8_t ROW_ALTITUDE = 2;
 static const uint8_t COL_ALTITUDE = 0;
 static const uint8_t ROW_SATELLITE = 2;
 static const uint8_t COL_SATELLITE = 12;
+static const uint8_t ROW_GATE = 2;
+static const uint8_t COL_GATE = 17;
 static const uint8_t ROW_TZ = 3;
 static const uint8_t COL_TZ = 0;
 static const uint8_t KEEP_ROWS = 1;
 #endif
 #endif
 
+// Column at which the local time of a proposed timezone is previewed, which is right-aligned in the
+// row of the timezone.
+static const uint8_t COL_PREVIEW = DISPLAY_COLS - 5;
+
+// Columns of the two values shown in each row of diagnostics, where each value is preceded by a
+// label of 3 characters and right-aligned in the remaining width.
+static const uint8_t COL_DIAG_LEFT = 0;
+static const uint8_t COL_DIAG_RIGHT = 10;
+static const uint8_t DIAG_VALUE_WIDTH = 6;
+
 // Decide whether or not UTC is shown based on display size constraints.
 #if defined(GPS_DISPLAY_OLED) && defined(OLED_SIZE_SMALL)
 #undef SHOW_UTC
@@ -309,7 +325,9 @@ gps_display::gps_display()
   : display(DISPLAY_WIDTH, DISPLAY_HEIGHT),
 #endif
     searching(false),
-    displaying(true) {
+    displaying(true),
+    inspecting(false),
+    gate(gate_ok) {
 #if defined(GPS_DISPLAY_LCD)
   display.begin(DISPLAY_COLS, DISPLAY_ROWS);
   display.clear();
@@ -338,6 +356,28 @@ void gps_display::show_info(const gps_info& info, const gps_time& time) {
     write_altitude(info);
     write_satellites(info);
     write_utc(time);
+    gate = gate_ok;
+    write_gate();
+    display.display();
+  }
+}
+
+void gps_display::show_time(const gps_time& time) {
+  // Time is known before position, so UTC is shown while the display otherwise indicates that a
+  // position fix is still being sought.
+  if (displaying) {
+    show_searching();
+    write_utc(time);
+    display.display();
+  }
+}
+
+void gps_display::show_degraded(gps_gate gate) {
+  // Last known information remains visible, though annotated with the reason that newer
+  // information is being withheld from the clock.
+  if (displaying && !searching && gate != this->gate) {
+    this->gate = gate;
+    write_gate();
     display.display();
   }
 }
@@ -355,13 +395,26 @@ void gps_display::show_searching() {
   }
 }
 
-void gps_display::show_tz(const tz_info* tz, bool pending) {
+void gps_display::show_tz(const tz_info& tz, bool pending) {
   if (displaying) {
     write_tz(tz, pending);
     display.display();
   }
 }
 
+void gps_display::show_preview(const tz_info& tz, const local_time& time) {
+  if (displaying) {
+    write_tz(tz, true);
+    set_cursor(COL_PREVIEW, ROW_TZ);
+    display.print(time.hour / 10 % 10);
+    display.print(time.hour % 10);
+    display.print(':');
+    display.print(time.minute / 10 % 10);
+    display.print(time.minute % 10);
+    display.display();
+  }
+}
+
 void gps_display::show_display(bool on) {
   displaying = on;
 #if defined(GPS_DISPLAY_LCD)
@@ -377,6 +430,59 @@ void gps_display::show_display(bool on) {
 #endif
 }
 
+void gps_display::show_diagnostics(const diagnostics& diag) {
+  // Diagnostics take over the entire display, including the timezone, until hidden again. Times
+  // of startup stages are shown in milliseconds since reset, and time to first fix in milliseconds
+  // since the GPS module was configured.
+  if (displaying) {
+    if (!inspecting) {
+      for (uint8_t row = 0; row < DISPLAY_ROWS; ++row)
+        clear_row(row);
+      inspecting = true;
+    }
+    set_cursor(COL_DIAG_LEFT, 0);
+    display.print(F("frm"));
+    write_stat(diag.boot.first_frame_ms, true);
+    set_cursor(COL_DIAG_RIGHT, 0);
+    display.print(F("clk"));
+    write_stat(diag.boot.clock_ms, true);
+    set_cursor(COL_DIAG_LEFT, 1);
+    display.print(F("dsp"));
+    write_stat(diag.boot.display_ms, diag.boot.display_ms > 0);
+    set_cursor(COL_DIAG_RIGHT, 1);
+    display.print(F("gps"));
+    write_stat(diag.boot.gps_ms, diag.boot.gps_ms > 0);
+    set_cursor(COL_DIAG_LEFT, 2);
+    display.print(F("ttf"));
+    write_stat(diag.gps.ttff_ms, diag.gps.ttff_ms > 0);
+    set_cursor(COL_DIAG_RIGHT, 2);
+    display.print(F("buf"));
+    write_stat(diag.gps.high_water, true);
+
+    // Utilization and wakes are only known once the first window of measurement has passed.
+    bool measured = diag.sched.window_wakes > 0;
+    set_cursor(COL_DIAG_LEFT, 3);
+    display.print(F("cpu"));
+    write_stat(diag.sched.utilization, measured);
+    set_cursor(COL_DIAG_RIGHT, 3);
+    display.print(F("wak"));
+    write_stat(diag.sched.window_wakes, measured);
+    display.display();
+  }
+}
+
+void gps_display::hide_diagnostics() {
+  // Everything is cleared, so the caller must show GPS information and the timezone again.
+  if (inspecting) {
+    for (uint8_t row = 0; row < DISPLAY_ROWS; ++row)
+      clear_row(row);
+    display.display();
+    inspecting = false;
+    searching = false;
+    gate = gate_ok;
+  }
+}
+
 void gps_display::write_lat(const gps_info& info) {
   float lat;
   char lat_dir;
@@ -464,6 +570,27 @@ void gps_display::write_satellites(const gps_info& info) {
   clear_row(ROW_SATELLITE, n);
 }
 
+void gps_display::write_gate() {
+  set_cursor(COL_GATE, ROW_GATE);
+  switch (gate) {
+    case gate_no_fix:
+      display.print(F("FIX"));
+      break;
+    case gate_stale:
+      display.print(F("AGE"));
+      break;
+    case gate_hdop:
+      display.print(F("DOP"));
+      break;
+    case gate_inconsistent:
+      display.print(F("JMP"));
+      break;
+    default:
+      display.print(F("   "));
+      break;
+  }
+}
+
 void gps_display::write_utc(const gps_time& time) {
 #if defined(SHOW_UTC)
 #if defined(GPS_DISPLAY_LCD)
@@ -527,14 +654,28 @@ void gps_display::write_day(const gps_time& time) {
   display.print(time.day % 10);
 }
 
-void gps_display::write_tz(const tz_info* tz, bool pending) {
+void gps_display::write_tz(const tz_info& tz, bool pending) {
   draw_bitmap(COL_TZ, ROW_TZ, BITMAP_TIMEZONE);
   set_cursor(COL_TZ + 2, ROW_TZ);
-  size_t n = COL_TZ + 2 + display.print(tz->name);
+  size_t n = COL_TZ + 2 + display.print(tz.name);
   display.print(pending ? '?' : ' ');
   clear_row(ROW_TZ, n + 1);
 }
 
+void gps_display::write_stat(uint32_t value, bool known) {
+  // Values that are not yet known, or too large to fit, are shown as a dash.
+  uint8_t digits = 1;
+  for (uint32_t n = value; n >= 10; n /= 10)
+    ++digits;
+  known = known && digits <= DIAG_VALUE_WIDTH;
+  for (uint8_t n = known ? digits : 1; n <= DIAG_VALUE_WIDTH; ++n)
+    display.print(' ');
+  if (known)
+    display.print(value);
+  else
+    display.print('-');
+}
+
 void gps_display::clear_gps() {
   for (uint8_t row = 0; row < DISPLAY_ROWS - KEEP_ROWS; ++row)
     clear_row(row);
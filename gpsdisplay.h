@@ -18,7 +18,9 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "clock.h"
 #include "gps.h"
+#include "scheduler.h"
 #include "timezones.h"
 
 #if defined(GPS_DISPLAY_LCD)
@@ -31,13 +33,34 @@
 #include <Adafruit_SSD1306.h>
 #endif
 
+// Number of milliseconds since reset at which each stage of startup completed, where the first
+// frame is the moment the clock display first shows anything, or zero if not yet complete.
+struct boot_stats {
+  uint32_t first_frame_ms;
+  uint32_t clock_ms;
+  uint32_t display_ms;
+  uint32_t gps_ms;
+};
+
+// Diagnostics shown on request in place of GPS information.
+struct diagnostics {
+  boot_stats boot;
+  gps_stats gps;
+  scheduler_stats sched;
+};
+
 class gps_display {
 public:
   gps_display();
   void show_info(const gps_info& info, const gps_time& time);
   void show_searching();
-  void show_tz(const tz_info* tz, bool pending);
+  void show_time(const gps_time& time);
+  void show_degraded(gps_gate gate);
+  void show_tz(const tz_info& tz, bool pending);
+  void show_preview(const tz_info& tz, const local_time& time);
   void show_display(bool on);
+  void show_diagnostics(const diagnostics& diag);
+  void hide_diagnostics();
 
 private:
 #if defined(GPS_DISPLAY_LCD)
@@ -52,16 +75,20 @@ private:
 
   bool searching;
   bool displaying;
+  bool inspecting;
+  gps_gate gate;
 
   void write_lat(const gps_info& info);
   void write_lon(const gps_info& info);
   void write_altitude(const gps_info& info);
   void write_satellites(const gps_info& info);
+  void write_gate();
   void write_utc(const gps_time& time);
   void write_year(const gps_time& time);
   void write_month(const gps_time& time);
   void write_day(const gps_time& time);
-  void write_tz(const tz_info* tz, bool pending);
+  void write_tz(const tz_info& tz, bool pending);
+  void write_stat(uint32_t value, bool known);
   void clear_gps();
   void clear_row(uint8_t row, uint8_t col = 0);
   void set_cursor(uint8_t col, uint8_t row);
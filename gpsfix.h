@@ -0,0 +1,62 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __GPSFIX_H
+#define __GPSFIX_H
+
+#include <Arduino.h>
+
+// Flags that indicate which groups of fields in `gps_fix` have been decoded.
+static const uint8_t FIX_TIME = 0x01;
+static const uint8_t FIX_DATE = 0x02;
+static const uint8_t FIX_LOCATION = 0x04;
+static const uint8_t FIX_ALTITUDE = 0x08;
+static const uint8_t FIX_SATELLITES = 0x10;
+static const uint8_t FIX_QUALITY = 0x20;
+
+// Value of `accuracy_ns` when the module does not estimate the accuracy of its time.
+static const uint32_t ACCURACY_UNKNOWN = UINT32_MAX;
+
+// Most recent information decoded from the GPS module, where a group of fields is only meaningful
+// if its corresponding flag is set in `valid`.
+//
+// `nano` is the fraction of the second to which the time refers, which may be slightly negative,
+// and `accuracy_ns` is the estimated accuracy of the time reported by the module.
+//
+// `active` reflects whether the most recent sentence reported that the module has a fix, whereas
+// `quality_ms` is the time at which fix quality and HDOP were last decoded, which allows callers to
+// reject information that has gone stale.
+struct gps_fix {
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint8_t centisecond;
+  int32_t nano;
+  uint32_t accuracy_ns;
+  float lat;
+  float lon;
+  float altitude;
+  uint8_t satellites;
+  uint8_t quality;
+  float hdop;
+  uint32_t quality_ms;
+  bool active;
+  uint8_t valid;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,451 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gpsmodule.h"
+#include "config.h"
+
+// Maximum amount of time to wait for the module to acknowledge a command.
+static const uint32_t ACK_TIMEOUT_MS = 1000;
+
+gps_module::gps_module(Stream& serial)
+  : serial(serial),
+    ack(ack_none),
+    sent_ms(0) {
+}
+
+gps_ack gps_module::get_ack() {
+  if (ack == ack_pending && millis() - sent_ms >= ACK_TIMEOUT_MS)
+    ack = ack_timeout;
+  return ack;
+}
+
+#if defined(GPS_MODULE_MTK)
+
+// Only GGA and RMC sentences are emitted once per fix, where fields correspond to GLL, RMC, VTG,
+// GGA, GSA, GSV and so on.
+static const char PMTK_SENTENCES[] = "0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0";
+
+// Commands understood by MTK modules.
+static const uint16_t PMTK_ACK = 1;
+static const uint16_t PMTK_SET_NMEA_UPDATERATE = 220;
+static const uint16_t PMTK_SET_NMEA_BAUDRATE = 251;
+static const uint16_t PMTK_API_SET_NMEA_OUTPUT = 314;
+static const uint16_t PMTK_API_SET_STATIC_NAV_THD = 386;
+static const uint16_t PMTK_API_SET_POS_TIME = 741;
+
+// Speed in m/s below which the module holds its position, which is the closest that MTK modules
+// come to a fixed-position timing mode.
+static const char PMTK_STATIC_NAV_THD[] = "2.0";
+
+// Flag in PMTK_ACK indicating that the command succeeded.
+static const char PMTK_ACK_SUCCESS = '3';
+
+// Number of characters of an acknowledgement matched so far when it can no longer match.
+static const uint8_t MATCH_FAILED = 0xFF;
+
+// Writes the decimal representation of a number into a buffer that must be large enough to hold
+// 10 digits and the terminator.
+static char* to_decimal(char* buf, uint32_t n) {
+  char digits[10];
+  uint8_t len = 0;
+  do {
+    digits[len++] = '0' + n % 10;
+    n /= 10;
+  } while (n > 0);
+  for (uint8_t i = 0; i < len; ++i)
+    buf[i] = digits[len - 1 - i];
+  buf[len] = '\0';
+  return buf;
+}
+
+// Appends the fixed-point representation of a number to a buffer.
+static void append_fixed(char* buf, float n, uint8_t decimals) {
+  char* p = buf + strlen(buf);
+  if (n < 0) {
+    *p++ = '-';
+    n = -n;
+  }
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; ++i)
+    scale *= 10;
+  uint32_t value = static_cast<uint32_t>(n * scale + 0.5);
+  to_decimal(p, value / scale);
+  p += strlen(p);
+  *p++ = '.';
+  for (uint32_t d = scale / 10; d > 0; d /= 10)
+    *p++ = '0' + value % scale / d % 10;
+  *p = '\0';
+}
+
+// Appends a comma followed by the decimal representation of a number padded to the given width.
+static void append_field(char* buf, uint16_t n, uint8_t width) {
+  char* p = buf + strlen(buf);
+  *p++ = ',';
+  for (uint16_t d = width == 4 ? 1000 : 10; d > 0; d /= 10)
+    *p++ = '0' + n / d % 10;
+  *p = '\0';
+}
+
+bool gps_module::set_sentences(uint8_t index) {
+  if (index > 0)
+    return false;
+  send_pmtk(PMTK_API_SET_NMEA_OUTPUT, PMTK_SENTENCES);
+  return true;
+}
+
+void gps_module::set_update_rate(uint16_t interval_ms) {
+  char args[11];
+  send_pmtk(PMTK_SET_NMEA_UPDATERATE, to_decimal(args, interval_ms));
+}
+
+bool gps_module::set_position(uint8_t index, float, float, float) {
+  // Module has no fixed-position mode, so the position itself is not conveyed.
+  if (index > 0)
+    return false;
+  send_pmtk(PMTK_API_SET_STATIC_NAV_THD, PMTK_STATIC_NAV_THD);
+  return true;
+}
+
+void gps_module::set_aiding(float lat, float lon, float altitude, const civil_time& time, uint32_t) {
+  // Lat,Long,Alt,YYYY,MM,DD,hh,mm,ss, where the module offers no means of conveying accuracy.
+  char args[64] = "";
+  append_fixed(args, lat, 6);
+  strcat(args, ",");
+  append_fixed(args, lon, 6);
+  strcat(args, ",");
+  append_fixed(args, altitude, 1);
+  append_field(args, time.year, 4);
+  append_field(args, time.month, 2);
+  append_field(args, time.day, 2);
+  append_field(args, time.hour, 2);
+  append_field(args, time.minute, 2);
+  append_field(args, time.second, 2);
+  send_pmtk(PMTK_API_SET_POS_TIME, args);
+}
+
+void gps_module::set_baud_rate(long baud_rate) {
+  char args[11];
+  write_pmtk(PMTK_SET_NMEA_BAUDRATE, to_decimal(args, baud_rate));
+  ack = ack_none;
+}
+
+void gps_module::encode(char c) {
+  // Looks for $PMTK001,ccc,f where ccc is the command and f is the outcome, which is matched one
+  // character at a time so that nothing needs to be buffered.
+  if (ack != ack_pending)
+    return;
+  if (c == '$')
+    matched = 0;
+  if (matched < expected_len)
+    matched = c == expected[matched] ? matched + 1 : MATCH_FAILED;
+  else if (matched == expected_len)
+    ack = c == PMTK_ACK_SUCCESS ? ack_accepted : ack_rejected;
+}
+
+void gps_module::send_pmtk(uint16_t cmd, const char* args) {
+  // Acknowledgement of the command is $PMTK001,ccc,f where ccc is the command.
+  strcpy(expected, "$PMTK001,");
+  to_decimal(expected + 9, cmd);
+  strncat(expected, ",", sizeof(expected) - strlen(expected) - 1);
+  expected_len = strlen(expected);
+  matched = MATCH_FAILED;
+  write_pmtk(cmd, args);
+  ack = ack_pending;
+  sent_ms = millis();
+}
+
+void gps_module::write_pmtk(uint16_t cmd, const char* args) {
+  // $PMTKccc,args*hh<CR><LF>
+  char body[80] = "PMTK";
+  to_decimal(body + 4, cmd);
+  strncat(body, ",", sizeof(body) - strlen(body) - 1);
+  strncat(body, args, sizeof(body) - strlen(body) - 1);
+
+  uint8_t checksum = 0;
+  for (const char* c = body; *c; ++c)
+    checksum ^= *c;
+
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  serial.write('$');
+  serial.print(body);
+  serial.write('*');
+  serial.write(HEX_DIGITS[checksum >> 4]);
+  serial.write(HEX_DIGITS[checksum & 0x0F]);
+  serial.print("\r\n");
+}
+
+#elif defined(GPS_MODULE_UBLOX)
+
+// Message classes and identifiers understood by u-blox modules.
+static const uint8_t UBX_SYNC_1 = 0xB5;
+static const uint8_t UBX_SYNC_2 = 0x62;
+static const uint8_t UBX_ACK = 0x05;
+static const uint8_t UBX_ACK_NAK = 0x00;
+static const uint8_t UBX_ACK_ACK = 0x01;
+static const uint8_t UBX_CFG = 0x06;
+static const uint8_t UBX_CFG_PRT = 0x00;
+static const uint8_t UBX_CFG_MSG = 0x01;
+static const uint8_t UBX_CFG_RATE = 0x08;
+static const uint8_t UBX_CFG_NAV5 = 0x24;
+static const uint8_t UBX_CFG_TMODE2 = 0x3D;
+static const uint8_t UBX_AID = 0x0B;
+static const uint8_t UBX_AID_INI = 0x01;
+static const uint8_t UBX_NAV = 0x01;
+static const uint8_t UBX_NAV_POSLLH = 0x02;
+static const uint8_t UBX_NAV_SOL = 0x06;
+static const uint8_t UBX_NAV_PVT = 0x07;
+static const uint8_t UBX_NAV_TIMEUTC = 0x21;
+static const uint8_t UBX_NMEA = 0xF0;
+
+#if defined(GPS_PROTOCOL_UBX)
+// Standard NMEA sentences in the order of their message identifiers, none of which are emitted
+// since navigation messages are used instead.
+static const uint8_t NMEA_RATES[] = { 0, 0, 0, 0, 0, 0 };
+
+// Navigation messages emitted once per fix, where NAV-TIMEUTC is last so that it arrives after the
+// quality and position of the same fix.
+static const uint8_t NAV_MESSAGES[] = {
+  UBX_NAV_POSLLH,
+  UBX_NAV_SOL,
+  UBX_NAV_TIMEUTC
+};
+#else
+// Standard NMEA sentences in the order of their message identifiers, where only GGA and RMC are
+// emitted once per fix.
+static const uint8_t NMEA_RATES[] = {
+  1, // GGA
+  0, // GLL
+  0, // GSA
+  0, // GSV
+  1, // RMC
+  0  // VTG
+};
+#endif
+
+// Fixed-position timing mode in which the position is given as latitude, longitude and altitude.
+static const uint8_t UBX_TMODE_FIXED = 2;
+static const uint16_t UBX_TMODE_LLA = 0x0001;
+
+// Accuracy in mm claimed for a surveyed position.
+static const uint32_t UBX_TMODE_ACCURACY_MM = 10000;
+
+// Stationary dynamic model, which only applies the dynamic model field of CFG-NAV5.
+static const uint16_t UBX_NAV5_MASK_DYN = 0x0001;
+static const uint8_t UBX_NAV5_STATIONARY = 2;
+
+// Flags in AID-INI indicating that position is given as latitude, longitude and altitude, and
+// time is given as UTC date and time.
+static const uint32_t UBX_AID_POS_VALID = 0x0001;
+static const uint32_t UBX_AID_TIME_VALID = 0x0002;
+static const uint32_t UBX_AID_LLA = 0x0020;
+static const uint32_t UBX_AID_UTC = 0x0400;
+
+// Accuracy in cm claimed for the position used to aid the module.
+static const uint32_t UBX_AID_POS_ACCURACY_CM = 10000;
+
+// UART port on the module to which the GPS clock is attached.
+static const uint8_t UBX_PORT_UART1 = 1;
+
+// Port mode of 8 data bits, no parity and 1 stop bit.
+static const uint32_t UBX_MODE_8N1 = 0x000008D0;
+
+// Protocols accepted and emitted by the port.
+static const uint16_t UBX_PROTO_UBX = 0x0001;
+static const uint16_t UBX_PROTO_NMEA = 0x0002;
+
+bool gps_module::set_sentences(uint8_t index) {
+  // Each message sets the rate of one NMEA sentence, followed by one navigation message if UBX is
+  // the protocol in use.
+  if (index < sizeof(NMEA_RATES)) {
+    uint8_t payload[] = { UBX_NMEA, index, NMEA_RATES[index] };
+    send_ubx(UBX_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+    return true;
+  }
+#if defined(GPS_PROTOCOL_UBX)
+  index -= sizeof(NMEA_RATES);
+  if (index < sizeof(NAV_MESSAGES)) {
+    uint8_t payload[] = { UBX_NAV, NAV_MESSAGES[index], 1 };
+    send_ubx(UBX_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+    return true;
+  }
+  if (index == sizeof(NAV_MESSAGES)) {
+    // NAV-PVT supersedes the other messages on newer modules, but is not understood by older
+    // modules such as the NEO-6M, so the acknowledgement is not awaited.
+    uint8_t payload[] = { UBX_NAV, UBX_NAV_PVT, 1 };
+    write_ubx(UBX_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+    ack = ack_none;
+    return true;
+  }
+#endif
+  return false;
+}
+
+void gps_module::set_update_rate(uint16_t interval_ms) {
+  // Measurement rate, one navigation solution per measurement, aligned to UTC.
+  uint8_t payload[] = {
+    static_cast<uint8_t>(interval_ms), static_cast<uint8_t>(interval_ms >> 8),
+    0x01, 0x00,
+    0x00, 0x00
+  };
+  send_ubx(UBX_CFG, UBX_CFG_RATE, payload, sizeof(payload));
+}
+
+void gps_module::set_baud_rate(long baud_rate) {
+  uint32_t rate = baud_rate;
+  uint16_t in_proto = UBX_PROTO_UBX | UBX_PROTO_NMEA;
+#if defined(GPS_PROTOCOL_UBX)
+  uint16_t out_proto = UBX_PROTO_UBX;
+#else
+  uint16_t out_proto = UBX_PROTO_NMEA;
+#endif
+  uint8_t payload[] = {
+    UBX_PORT_UART1, 0x00,
+    0x00, 0x00,
+    static_cast<uint8_t>(UBX_MODE_8N1), static_cast<uint8_t>(UBX_MODE_8N1 >> 8),
+    static_cast<uint8_t>(UBX_MODE_8N1 >> 16), static_cast<uint8_t>(UBX_MODE_8N1 >> 24),
+    static_cast<uint8_t>(rate), static_cast<uint8_t>(rate >> 8),
+    static_cast<uint8_t>(rate >> 16), static_cast<uint8_t>(rate >> 24),
+    static_cast<uint8_t>(in_proto), static_cast<uint8_t>(in_proto >> 8),
+    static_cast<uint8_t>(out_proto), static_cast<uint8_t>(out_proto >> 8),
+    0x00, 0x00,
+    0x00, 0x00
+  };
+  write_ubx(UBX_CFG, UBX_CFG_PRT, payload, sizeof(payload));
+  ack = ack_none;
+}
+
+bool gps_module::set_position(uint8_t index, float lat, float lon, float altitude) {
+  // Timing modules accept a fixed position, which frees all satellites for timing. Other modules
+  // reject the command, in which case the stationary dynamic model is the nearest equivalent.
+  if (index > 1)
+    return false;
+  if (index == 1) {
+    uint8_t nav5[36] = {
+      static_cast<uint8_t>(UBX_NAV5_MASK_DYN), static_cast<uint8_t>(UBX_NAV5_MASK_DYN >> 8),
+      UBX_NAV5_STATIONARY
+    };
+    send_ubx(UBX_CFG, UBX_CFG_NAV5, nav5, sizeof(nav5));
+    return true;
+  }
+
+  int32_t lat_e7 = static_cast<int32_t>(lat * 1e7);
+  int32_t lon_e7 = static_cast<int32_t>(lon * 1e7);
+  int32_t alt_cm = static_cast<int32_t>(altitude * 100);
+  uint8_t tmode[28] = {
+    UBX_TMODE_FIXED, 0x00,
+    static_cast<uint8_t>(UBX_TMODE_LLA), static_cast<uint8_t>(UBX_TMODE_LLA >> 8),
+    static_cast<uint8_t>(lat_e7), static_cast<uint8_t>(lat_e7 >> 8),
+    static_cast<uint8_t>(lat_e7 >> 16), static_cast<uint8_t>(lat_e7 >> 24),
+    static_cast<uint8_t>(lon_e7), static_cast<uint8_t>(lon_e7 >> 8),
+    static_cast<uint8_t>(lon_e7 >> 16), static_cast<uint8_t>(lon_e7 >> 24),
+    static_cast<uint8_t>(alt_cm), static_cast<uint8_t>(alt_cm >> 8),
+    static_cast<uint8_t>(alt_cm >> 16), static_cast<uint8_t>(alt_cm >> 24),
+    static_cast<uint8_t>(UBX_TMODE_ACCURACY_MM), static_cast<uint8_t>(UBX_TMODE_ACCURACY_MM >> 8),
+    static_cast<uint8_t>(UBX_TMODE_ACCURACY_MM >> 16), static_cast<uint8_t>(UBX_TMODE_ACCURACY_MM >> 24)
+  };
+  send_ubx(UBX_CFG, UBX_CFG_TMODE2, tmode, sizeof(tmode));
+  return true;
+}
+
+void gps_module::set_aiding(float lat, float lon, float altitude, const civil_time& time, uint32_t accuracy_ms) {
+  // Date is encoded as YYMM and time as DDHHMMSS, and the message is not acknowledged.
+  int32_t lat_e7 = static_cast<int32_t>(lat * 1e7);
+  int32_t lon_e7 = static_cast<int32_t>(lon * 1e7);
+  int32_t alt_cm = static_cast<int32_t>(altitude * 100);
+  uint16_t date = (time.year - 2000) * 100 + time.month;
+  uint32_t clock = time.day * 1000000UL + time.hour * 10000UL + time.minute * 100UL + time.second;
+  uint32_t flags = UBX_AID_POS_VALID | UBX_AID_TIME_VALID | UBX_AID_LLA | UBX_AID_UTC;
+  uint8_t payload[48] = {
+    static_cast<uint8_t>(lat_e7), static_cast<uint8_t>(lat_e7 >> 8),
+    static_cast<uint8_t>(lat_e7 >> 16), static_cast<uint8_t>(lat_e7 >> 24),
+    static_cast<uint8_t>(lon_e7), static_cast<uint8_t>(lon_e7 >> 8),
+    static_cast<uint8_t>(lon_e7 >> 16), static_cast<uint8_t>(lon_e7 >> 24),
+    static_cast<uint8_t>(alt_cm), static_cast<uint8_t>(alt_cm >> 8),
+    static_cast<uint8_t>(alt_cm >> 16), static_cast<uint8_t>(alt_cm >> 24),
+    static_cast<uint8_t>(UBX_AID_POS_ACCURACY_CM), static_cast<uint8_t>(UBX_AID_POS_ACCURACY_CM >> 8),
+    static_cast<uint8_t>(UBX_AID_POS_ACCURACY_CM >> 16), static_cast<uint8_t>(UBX_AID_POS_ACCURACY_CM >> 24),
+    0x00, 0x00,
+    static_cast<uint8_t>(date), static_cast<uint8_t>(date >> 8),
+    static_cast<uint8_t>(clock), static_cast<uint8_t>(clock >> 8),
+    static_cast<uint8_t>(clock >> 16), static_cast<uint8_t>(clock >> 24),
+    0x00, 0x00, 0x00, 0x00,
+    static_cast<uint8_t>(accuracy_ms), static_cast<uint8_t>(accuracy_ms >> 8),
+    static_cast<uint8_t>(accuracy_ms >> 16), static_cast<uint8_t>(accuracy_ms >> 24),
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+    static_cast<uint8_t>(flags), static_cast<uint8_t>(flags >> 8),
+    static_cast<uint8_t>(flags >> 16), static_cast<uint8_t>(flags >> 24)
+  };
+  write_ubx(UBX_AID, UBX_AID_INI, payload, sizeof(payload));
+  ack = ack_none;
+}
+
+void gps_module::poll_port() {
+  // Polling the port configuration elicits a response in UBX regardless of which protocols the
+  // module is currently emitting.
+  uint8_t payload[] = { UBX_PORT_UART1 };
+  write_ubx(UBX_CFG, UBX_CFG_PRT, payload, sizeof(payload));
+  ack = ack_none;
+}
+
+void gps_module::encode(char c) {
+  // Looks for ACK-ACK or ACK-NAK referring to the awaited message, which is matched against a
+  // sliding window of the most recently received bytes.
+  if (ack != ack_pending)
+    return;
+  memmove(window, window + 1, sizeof(window) - 1);
+  window[sizeof(window) - 1] = c;
+  if (window[0] == UBX_SYNC_1 && window[1] == UBX_SYNC_2 && window[2] == UBX_ACK &&
+      window[4] == 2 && window[5] == 0 && window[6] == expected_cls && window[7] == expected_id) {
+    if (window[3] == UBX_ACK_ACK)
+      ack = ack_accepted;
+    else if (window[3] == UBX_ACK_NAK)
+      ack = ack_rejected;
+  }
+}
+
+void gps_module::send_ubx(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len) {
+  expected_cls = cls;
+  expected_id = id;
+  memset(window, 0, sizeof(window));
+  write_ubx(cls, id, payload, len);
+  ack = ack_pending;
+  sent_ms = millis();
+}
+
+void gps_module::write_ubx(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len) {
+  // Checksum is an 8-bit Fletcher algorithm over everything but the sync characters.
+  uint8_t header[] = { cls, id, static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8) };
+  uint8_t ck_a = 0;
+  uint8_t ck_b = 0;
+  for (uint8_t i = 0; i < sizeof(header); ++i) {
+    ck_a += header[i];
+    ck_b += ck_a;
+  }
+  for (uint16_t i = 0; i < len; ++i) {
+    ck_a += payload[i];
+    ck_b += ck_a;
+  }
+
+  serial.write(UBX_SYNC_1);
+  serial.write(UBX_SYNC_2);
+  serial.write(header, sizeof(header));
+  serial.write(payload, len);
+  serial.write(ck_a);
+  serial.write(ck_b);
+}
+
+#endif
\ No newline at end of file
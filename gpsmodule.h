@@ -0,0 +1,78 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __GPSMODULE_H
+#define __GPSMODULE_H
+
+#include <Arduino.h>
+#include "civil.h"
+#include "config.h"
+
+// Outcome of the command most recently sent to the GPS module, where `ack_none` indicates that the
+// command is not acknowledged by the module.
+enum gps_ack {
+  ack_none,
+  ack_pending,
+  ack_accepted,
+  ack_rejected,
+  ack_timeout
+};
+
+// Sends configuration commands to the GPS module, which is either MTK-based using PMTK sentences
+// or u-blox using UBX-CFG messages. Commands are sent without waiting for the module to respond.
+// Instead, the caller passes every byte it receives to `encode()`, which recognizes the
+// acknowledgement without disturbing anything else the module emits in the meantime.
+//
+// Baud rate changes are never acknowledged since the acknowledgement would be sent at the old
+// rate. Where the module expects a series of messages, e.g. to enable several sentences, or offers
+// alternatives, e.g. for holding a fixed position, messages are selected by index, and `false` is
+// returned once the index is beyond the last message.
+class gps_module {
+public:
+  gps_module(Stream& serial);
+  bool set_sentences(uint8_t index);
+  void set_update_rate(uint16_t interval_ms);
+  void set_baud_rate(long baud_rate);
+  bool set_position(uint8_t index, float lat, float lon, float altitude);
+  void set_aiding(float lat, float lon, float altitude, const civil_time& time, uint32_t accuracy_ms);
+#if defined(GPS_MODULE_UBLOX)
+  void poll_port();
+#endif
+  void encode(char c);
+  gps_ack get_ack();
+
+private:
+  Stream& serial;
+  gps_ack ack;
+  uint32_t sent_ms;
+
+#if defined(GPS_MODULE_MTK)
+  char expected[16];
+  uint8_t expected_len;
+  uint8_t matched;
+
+  void send_pmtk(uint16_t cmd, const char* args);
+  void write_pmtk(uint16_t cmd, const char* args);
+#elif defined(GPS_MODULE_UBLOX)
+  uint8_t expected_cls;
+  uint8_t expected_id;
+  uint8_t window[8];
+
+  void send_ubx(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len);
+  void write_ubx(uint8_t cls, uint8_t id, const uint8_t* payload, uint16_t len);
+#endif
+};
+
+#endif
\ No newline at end of file
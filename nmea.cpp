@@ -0,0 +1,389 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "nmea.h"
+
+// Flags that track which fields appeared in the current sentence when the decision to commit
+// them depends on other fields, e.g. position is only committed if the module has a fix.
+static const uint8_t SEEN_LAT = 0x01;
+static const uint8_t SEEN_LON = 0x02;
+static const uint8_t SEEN_ALTITUDE = 0x04;
+static const uint8_t SEEN_DAY = 0x08;
+static const uint8_t SEEN_MONTH = 0x10;
+static const uint8_t SEEN_QUALITY = 0x20;
+static const uint8_t SEEN_HDOP = 0x40;
+static const uint8_t SEEN_TIME = 0x80;
+
+nmea_parser::nmea_parser()
+  : fix {},
+    pending {},
+    state(state_idle),
+    sentence(nmea_unknown),
+    checksum(0),
+    expected(0),
+    hex_digits(0),
+    field_index(0),
+    field_len(0),
+    field { '\0' },
+    active(false),
+    timed(false),
+    seen(0),
+    lat(0.0),
+    lon(0.0),
+    altitude(0.0),
+    sentences(0),
+    checksum_errors(0) {
+  fix.accuracy_ns = ACCURACY_UNKNOWN;
+}
+
+bool nmea_parser::encode(char c) {
+  if (c == '$') {
+    // Start of a new sentence always resets the parser, even if the prior sentence was truncated.
+    state = state_field;
+    sentence = nmea_unknown;
+    checksum = 0;
+    field_index = 0;
+    field_len = 0;
+    return false;
+  }
+
+  switch (state) {
+    case state_field:
+      if (c == '*') {
+        end_field();
+        if (state == state_field) {
+          state = state_checksum;
+          expected = 0;
+          hex_digits = 0;
+        }
+      } else if (c < ' ' || c > '~') {
+        // Garbage or line termination in the middle of a sentence.
+        state = state_idle;
+      } else {
+        checksum ^= c;
+        if (c == ',') {
+          end_field();
+          ++field_index;
+          field_len = 0;
+        } else if (field_len < NMEA_FIELD_SIZE) {
+          field[field_len++] = c;
+        }
+      }
+      return false;
+    case state_checksum: {
+      int8_t value = hex_value(c);
+      if (value < 0) {
+        state = state_idle;
+        return false;
+      }
+      expected = (expected << 4) | value;
+      if (++hex_digits < 2)
+        return false;
+      state = state_idle;
+      if (expected != checksum) {
+        ++checksum_errors;
+        return false;
+      }
+      return commit();
+    }
+    default:
+      return false;
+  }
+}
+
+bool nmea_parser::is_start(char c) const {
+  return c == '$';
+}
+
+const gps_fix& nmea_parser::get_fix() const {
+  return fix;
+}
+
+nmea_sentence nmea_parser::get_sentence() const {
+  return sentence;
+}
+
+bool nmea_parser::has_time() const {
+  return timed;
+}
+
+uint32_t nmea_parser::get_sentences() const {
+  return sentences;
+}
+
+uint16_t nmea_parser::get_checksum_errors() const {
+  return checksum_errors;
+}
+
+void nmea_parser::end_field() {
+  field[field_len] = '\0';
+  if (field_index == 0) {
+    // Address field determines whether the remainder of the sentence is worth parsing.
+    sentence = to_sentence(field, field_len);
+    if (sentence == nmea_unknown) {
+      state = state_idle;
+    } else {
+      pending = fix;
+      active = false;
+      seen = 0;
+    }
+  } else {
+    switch (sentence) {
+      case nmea_rmc:
+        parse_rmc();
+        break;
+      case nmea_gga:
+        parse_gga();
+        break;
+      case nmea_zda:
+        parse_zda();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void nmea_parser::parse_rmc() {
+  // $--RMC,hhmmss.ss,A,ddmm.mm,N,dddmm.mm,W,x.x,x.x,ddmmyy,x.x,a*hh
+  switch (field_index) {
+    case 1:
+      parse_time();
+      break;
+    case 2:
+      active = field[0] == 'A';
+      break;
+    case 3:
+      if (field_len > 0) {
+        lat = parse_degrees(field);
+        seen |= SEEN_LAT;
+      }
+      break;
+    case 4:
+      if (field[0] == 'S')
+        lat = -lat;
+      break;
+    case 5:
+      if (field_len > 0) {
+        lon = parse_degrees(field);
+        seen |= SEEN_LON;
+      }
+      break;
+    case 6:
+      if (field[0] == 'W')
+        lon = -lon;
+      break;
+    case 9:
+      if (field_len == 6) {
+        pending.day = parse_digits(field, 2);
+        pending.month = parse_digits(field + 2, 2);
+        pending.year = 2000 + parse_digits(field + 4, 2);
+        pending.valid |= FIX_DATE;
+      }
+      break;
+  }
+}
+
+void nmea_parser::parse_gga() {
+  // $--GGA,hhmmss.ss,ddmm.mm,N,dddmm.mm,W,q,ss,x.x,x.x,M,x.x,M,x.x,xxxx*hh
+  switch (field_index) {
+    case 1:
+      parse_time();
+      break;
+    case 2:
+      if (field_len > 0) {
+        lat = parse_degrees(field);
+        seen |= SEEN_LAT;
+      }
+      break;
+    case 3:
+      if (field[0] == 'S')
+        lat = -lat;
+      break;
+    case 4:
+      if (field_len > 0) {
+        lon = parse_degrees(field);
+        seen |= SEEN_LON;
+      }
+      break;
+    case 5:
+      if (field[0] == 'W')
+        lon = -lon;
+      break;
+    case 6:
+      if (field_len > 0) {
+        pending.quality = parse_digits(field, 1);
+        seen |= SEEN_QUALITY;
+      }
+      active = (seen & SEEN_QUALITY) && pending.quality > 0;
+      break;
+    case 7:
+      if (field_len > 0) {
+        pending.satellites = parse_digits(field, field_len);
+        pending.valid |= FIX_SATELLITES;
+      }
+      break;
+    case 8:
+      if (field_len > 0) {
+        pending.hdop = parse_decimal(field);
+        seen |= SEEN_HDOP;
+      }
+      break;
+    case 9:
+      if (field_len > 0) {
+        altitude = parse_decimal(field);
+        seen |= SEEN_ALTITUDE;
+      }
+      break;
+  }
+}
+
+void nmea_parser::parse_zda() {
+  // $--ZDA,hhmmss.ss,dd,mm,yyyy,xx,xx*hh
+  switch (field_index) {
+    case 1:
+      parse_time();
+      break;
+    case 2:
+      if (field_len == 2) {
+        pending.day = parse_digits(field, 2);
+        seen |= SEEN_DAY;
+      }
+      break;
+    case 3:
+      if (field_len == 2) {
+        pending.month = parse_digits(field, 2);
+        seen |= SEEN_MONTH;
+      }
+      break;
+    case 4:
+      if (field_len == 4 && (seen & (SEEN_DAY | SEEN_MONTH)) == (SEEN_DAY | SEEN_MONTH)) {
+        pending.year = parse_digits(field, 4);
+        pending.valid |= FIX_DATE;
+      }
+      break;
+  }
+}
+
+void nmea_parser::parse_time() {
+  // hhmmss or hhmmss.ss
+  if (field_len >= 6) {
+    pending.hour = parse_digits(field, 2);
+    pending.minute = parse_digits(field + 2, 2);
+    pending.second = parse_digits(field + 4, 2);
+    pending.centisecond = field_len >= 9 && field[6] == '.' ? parse_digits(field + 7, 2) : 0;
+    pending.nano = pending.centisecond * 10000000L;
+    pending.valid |= FIX_TIME;
+    seen |= SEEN_TIME;
+  }
+}
+
+bool nmea_parser::commit() {
+  // Fix quality and HDOP are only meaningful together and are timestamped so that callers can
+  // detect when the module stops reporting them.
+  if (sentence == nmea_gga && (seen & (SEEN_QUALITY | SEEN_HDOP)) == (SEEN_QUALITY | SEEN_HDOP)) {
+    pending.quality_ms = millis();
+    pending.valid |= FIX_QUALITY;
+  }
+  if (sentence != nmea_zda)
+    pending.active = active;
+
+  // Position is only committed if the sentence indicates that the module has a fix.
+  if (active) {
+    if ((seen & (SEEN_LAT | SEEN_LON)) == (SEEN_LAT | SEEN_LON)) {
+      pending.lat = lat;
+      pending.lon = lon;
+      pending.valid |= FIX_LOCATION;
+    }
+    if (seen & SEEN_ALTITUDE) {
+      pending.altitude = altitude;
+      pending.valid |= FIX_ALTITUDE;
+    }
+  }
+  // Only RMC and ZDA carry both date and time, so only those sentences label the second.
+  timed = (sentence == nmea_rmc || sentence == nmea_zda) && (seen & SEEN_TIME);
+  fix = pending;
+  ++sentences;
+  return true;
+}
+
+nmea_sentence nmea_parser::to_sentence(const char* address, uint8_t len) {
+  // Address is a 2-character talker, e.g. GP or GN, followed by the 3-character sentence type.
+  // Proprietary sentences begin with P and are never of interest.
+  if (len != 5 || address[0] == 'P')
+    return nmea_unknown;
+  else if (strcmp(address + 2, "RMC") == 0)
+    return nmea_rmc;
+  else if (strcmp(address + 2, "GGA") == 0)
+    return nmea_gga;
+  else if (strcmp(address + 2, "ZDA") == 0)
+    return nmea_zda;
+  else
+    return nmea_unknown;
+}
+
+uint32_t nmea_parser::parse_digits(const char* s, uint8_t n) {
+  uint32_t value = 0;
+  for (; n > 0 && isdigit(*s); --n)
+    value = value * 10 + (*s++ - '0');
+  return value;
+}
+
+float nmea_parser::parse_decimal(const char* s) {
+  bool negative = *s == '-';
+  if (negative)
+    ++s;
+  uint32_t whole = 0;
+  while (isdigit(*s))
+    whole = whole * 10 + (*s++ - '0');
+  float value = whole;
+  if (*s == '.') {
+    float scale = 0.1;
+    for (++s; isdigit(*s); ++s) {
+      value += (*s - '0') * scale;
+      scale *= 0.1;
+    }
+  }
+  return negative ? -value : value;
+}
+
+float nmea_parser::parse_degrees(const char* s) {
+  // Format is (d)ddmm.mmmm where the fractional part belongs to minutes. The fraction is kept as an
+  // integer until the end to avoid accumulating floating-point error.
+  uint32_t whole = 0;
+  while (isdigit(*s))
+    whole = whole * 10 + (*s++ - '0');
+  uint32_t frac = 0;
+  uint32_t scale = 1;
+  if (*s == '.') {
+    for (++s; isdigit(*s) && scale < 1000000; ++s) {
+      frac = frac * 10 + (*s - '0');
+      scale *= 10;
+    }
+  }
+  float minutes = (whole % 100) + static_cast<float>(frac) / scale;
+  return (whole / 100) + minutes / 60.0;
+}
+
+int8_t nmea_parser::hex_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  else if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  else if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  else
+    return -1;
+}
\ No newline at end of file
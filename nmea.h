@@ -0,0 +1,86 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __NMEA_H
+#define __NMEA_H
+
+#include <Arduino.h>
+#include "gpsfix.h"
+
+// Maximum number of characters retained for a single field of a sentence.
+static const uint8_t NMEA_FIELD_SIZE = 15;
+
+enum nmea_sentence {
+  nmea_unknown,
+  nmea_rmc,
+  nmea_gga,
+  nmea_zda
+};
+
+// Incremental parser that decodes only RMC, GGA and ZDA sentences. All other sentences are
+// skipped as soon as the address field is known, so no time is wasted tokenizing or checksumming
+// sentences that would otherwise be discarded.
+class nmea_parser {
+public:
+  nmea_parser();
+  bool encode(char c);
+  bool is_start(char c) const;
+  const gps_fix& get_fix() const;
+  nmea_sentence get_sentence() const;
+  bool has_time() const;
+  uint32_t get_sentences() const;
+  uint16_t get_checksum_errors() const;
+
+private:
+  enum parse_state {
+    state_idle,
+    state_field,
+    state_checksum
+  };
+
+  gps_fix fix;
+  gps_fix pending;
+  parse_state state;
+  nmea_sentence sentence;
+  uint8_t checksum;
+  uint8_t expected;
+  uint8_t hex_digits;
+  uint8_t field_index;
+  uint8_t field_len;
+  char field[NMEA_FIELD_SIZE + 1];
+  bool active;
+  bool timed;
+  uint8_t seen;
+  float lat;
+  float lon;
+  float altitude;
+  uint32_t sentences;
+  uint16_t checksum_errors;
+
+  void end_field();
+  void parse_rmc();
+  void parse_gga();
+  void parse_zda();
+  void parse_time();
+  bool commit();
+
+  static nmea_sentence to_sentence(const char* address, uint8_t len);
+  static uint32_t parse_digits(const char* s, uint8_t n);
+  static float parse_decimal(const char* s);
+  static float parse_degrees(const char* s);
+  static int8_t hex_value(char c);
+};
+
+#endif
\ No newline at end of file
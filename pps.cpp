@@ -0,0 +1,52 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pps.h"
+#include "config.h"
+
+// An edge older than this is considered stale, which usually means the GPS module has lost its
+// fix and stopped pulsing.
+static const uint32_t EDGE_TIMEOUT_MS = 1000;
+
+// Time of the most recent rising edge of the PPS signal, which is written only by the interrupt
+// handler.
+static volatile uint32_t last_edge_ms;
+static volatile bool edge_seen = false;
+
+pps_monitor::pps_monitor() {
+#if defined(PPS_PIN)
+  pinMode(PPS_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PPS_PIN), capture, RISING);
+#endif
+}
+
+bool pps_monitor::edge(uint32_t& edge_ms) {
+  // Copy with interrupts disabled since 32-bit reads are not atomic on 8-bit boards.
+  noInterrupts();
+  bool seen = edge_seen;
+  uint32_t ms = last_edge_ms;
+  interrupts();
+
+  if (seen && millis() - ms < EDGE_TIMEOUT_MS) {
+    edge_ms = ms;
+    return true;
+  } else
+    return false;
+}
+
+void pps_monitor::capture() {
+  last_edge_ms = millis();
+  edge_seen = true;
+}
\ No newline at end of file
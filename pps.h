@@ -0,0 +1,30 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __PPS_H
+#define __PPS_H
+
+#include <Arduino.h>
+
+class pps_monitor {
+public:
+  pps_monitor();
+  bool edge(uint32_t& edge_ms);
+
+private:
+  static void capture();
+};
+
+#endif
\ No newline at end of file
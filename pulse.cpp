@@ -0,0 +1,244 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pulse.h"
+#include "board.h"
+#include "config.h"
+
+#if defined(ARDUINO_ARCH_MBED)
+#include <mbed.h>
+#endif
+
+#if defined(PULSE_PIN) && defined(PULSE_MODE_PPS)
+// Width of each pulse.
+static const uint32_t PULSE_WIDTH_US = PULSE_WIDTH_MS * 1000;
+
+// A rising edge is produced if the timer expires within this many microseconds of when the edge
+// is due, which accounts for the resolution of the timer.
+static const uint32_t EDGE_TOLERANCE_US = 50;
+
+// Time of the next rising edge relative to micros(), and state of the pin, which are shared with
+// the timer interrupt.
+static volatile uint32_t rise_us;
+static volatile bool rise_pending = false;
+static volatile bool high = false;
+
+#if defined(ARDUINO_ARCH_AVR)
+// Timer1 runs freely with a prescaler of 8, which it shares with the capture-based serial
+// receiver on the Uno and Nano, so only compare unit B is used. Delays longer than the period of
+// the timer are reached in steps.
+static const uint32_t TICKS_PER_US = F_CPU / 8 / 1000000;
+static const uint32_t MAX_STEP_TICKS = 0x8000;
+static const uint32_t MIN_STEP_TICKS = 16;
+static volatile uint32_t remaining_ticks;
+#elif defined(ARDUINO_ARCH_MEGAAVR)
+// TCB2 counts at half the CPU clock in periodic interrupt mode, since the Nano Every uses TCA0 and
+// TCB0 for PWM, TCB1 for tone() and TCB3 for millis(). The counter restarts on each match, so
+// delays longer than its period are reached in steps without accumulating interrupt latency.
+static const uint32_t TICKS_PER_US = F_CPU / 2 / 1000000;
+static const uint32_t MAX_STEP_TICKS = 0x8000;
+static const uint32_t MIN_STEP_TICKS = 16;
+static volatile uint32_t remaining_ticks;
+#elif defined(ARDUINO_ARCH_SAMD)
+// TC4 counts at 48 MHz with a prescaler of 1024, which reaches 1.39 seconds in a single compare
+// with a resolution of 21 us.
+static const uint32_t CLOCK_MHZ = 48;
+static const uint32_t PRESCALER = 1024;
+static const uint32_t MAX_TICKS = 0xFFFF;
+#elif defined(ARDUINO_ARCH_MBED)
+static mbed::Timeout timeout;
+#else
+#error "PULSE_MODE_PPS: no timer for pulse output on this board"
+#endif
+#endif
+
+pulse_generator::pulse_generator() {
+#if defined(PULSE_LOCK_PIN)
+  pinMode(PULSE_LOCK_PIN, OUTPUT);
+  digitalWrite(PULSE_LOCK_PIN, LOW);
+#endif
+#if defined(PULSE_PIN)
+  pinMode(PULSE_PIN, OUTPUT);
+  digitalWrite(PULSE_PIN, LOW);
+#if defined(PULSE_MODE_1KHZ)
+  tone(PULSE_PIN, 1000);
+#elif defined(PULSE_MODE_10KHZ)
+  tone(PULSE_PIN, 10000);
+#elif defined(ARDUINO_ARCH_AVR) && !defined(USE_CAPTURE_SERIAL)
+  // Timer1 is configured identically to the capture-based serial receiver when that is not in
+  // use, which takes the timer away from PWM.
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TCCR1C = 0;
+  interrupts();
+#elif defined(ARDUINO_ARCH_MEGAAVR)
+  TCB2.CTRLA = 0;
+  TCB2.CTRLB = TCB_CNTMODE_INT_gc;
+  TCB2.INTCTRL = 0;
+  TCB2.INTFLAGS = TCB_CAPT_bm;
+#elif defined(ARDUINO_ARCH_SAMD)
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TC4_TC5;
+  while (GCLK->STATUS.bit.SYNCBUSY)
+    ;
+  TC4->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_NFRQ | TC_CTRLA_PRESCALER_DIV1024;
+  while (TC4->COUNT16.STATUS.bit.SYNCBUSY)
+    ;
+  TC4->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+  NVIC_SetPriority(TC4_IRQn, 0);
+  NVIC_EnableIRQ(TC4_IRQn);
+#endif
+#endif
+}
+
+void pulse_generator::arm(uint32_t delay_us) {
+  // Schedules the next rising edge, replacing any edge not yet produced. If the pin is currently
+  // high, the rising edge is scheduled once the falling edge has been produced.
+#if defined(PULSE_PIN) && defined(PULSE_MODE_PPS)
+  noInterrupts();
+  rise_us = micros() + delay_us;
+  rise_pending = true;
+  bool busy = high;
+  interrupts();
+  if (!busy)
+    start(delay_us);
+#else
+  (void)delay_us;
+#endif
+}
+
+void pulse_generator::set_locked(bool locked) {
+#if defined(PULSE_LOCK_PIN)
+  digitalWrite(PULSE_LOCK_PIN, locked ? HIGH : LOW);
+#else
+  (void)locked;
+#endif
+}
+
+void pulse_generator::start(uint32_t delay_us) {
+#if defined(PULSE_PIN) && defined(PULSE_MODE_PPS)
+  // Also called by the timer interrupt, so the interrupt flag is restored rather than set.
+#if defined(ARDUINO_ARCH_AVR)
+  uint8_t sreg = SREG;
+  cli();
+  remaining_ticks = delay_us * TICKS_PER_US;
+  step();
+  TIFR1 = _BV(OCF1B);
+  TIMSK1 |= _BV(OCIE1B);
+  SREG = sreg;
+#elif defined(ARDUINO_ARCH_MEGAAVR)
+  uint8_t sreg = SREG;
+  cli();
+  TCB2.CTRLA = 0;
+  TCB2.CNT = 0;
+  remaining_ticks = delay_us * TICKS_PER_US;
+  step();
+  TCB2.INTFLAGS = TCB_CAPT_bm;
+  TCB2.INTCTRL = TCB_CAPT_bm;
+  TCB2.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+  SREG = sreg;
+#elif defined(ARDUINO_ARCH_SAMD)
+  uint32_t ticks = delay_us * CLOCK_MHZ / PRESCALER;
+  TC4->COUNT16.CTRLA.bit.ENABLE = 0;
+  while (TC4->COUNT16.STATUS.bit.SYNCBUSY)
+    ;
+  TC4->COUNT16.COUNT.reg = 0;
+  TC4->COUNT16.CC[0].reg = ticks > MAX_TICKS ? MAX_TICKS : (ticks == 0 ? 1 : ticks);
+  while (TC4->COUNT16.STATUS.bit.SYNCBUSY)
+    ;
+  TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  TC4->COUNT16.CTRLA.bit.ENABLE = 1;
+  while (TC4->COUNT16.STATUS.bit.SYNCBUSY)
+    ;
+#elif defined(ARDUINO_ARCH_MBED)
+  timeout.attach(fire, std::chrono::microseconds(delay_us));
+#endif
+#else
+  (void)delay_us;
+#endif
+}
+
+void pulse_generator::fire() {
+  // Called in interrupt context when the timer expires, which produces the falling edge of a
+  // pulse in progress or the rising edge of the next pulse if it is due, and otherwise restarts
+  // the timer for the remaining time.
+#if defined(PULSE_PIN) && defined(PULSE_MODE_PPS)
+  if (high) {
+    digitalWrite(PULSE_PIN, LOW);
+    high = false;
+  } else if (rise_pending) {
+    int32_t wait_us = static_cast<int32_t>(rise_us - micros());
+    if (wait_us <= static_cast<int32_t>(EDGE_TOLERANCE_US)) {
+      digitalWrite(PULSE_PIN, HIGH);
+      high = true;
+      rise_pending = false;
+      start(PULSE_WIDTH_US);
+      return;
+    }
+  }
+  if (rise_pending) {
+    int32_t wait_us = static_cast<int32_t>(rise_us - micros());
+    start(wait_us > 0 ? wait_us : 0);
+  }
+#endif
+}
+
+void pulse_generator::step() {
+#if defined(PULSE_PIN) && defined(PULSE_MODE_PPS)
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
+  // Compare value must lie far enough ahead of the counter that it is not passed before it is
+  // written.
+  uint32_t ticks = remaining_ticks > MAX_STEP_TICKS ? MAX_STEP_TICKS : remaining_ticks;
+  if (ticks < MIN_STEP_TICKS)
+    ticks = MIN_STEP_TICKS;
+  remaining_ticks = remaining_ticks > ticks ? remaining_ticks - ticks : 0;
+#if defined(ARDUINO_ARCH_AVR)
+  OCR1B = TCNT1 + ticks;
+#else
+  TCB2.CCMP = ticks - 1;
+#endif
+#endif
+#endif
+}
+
+#if defined(PULSE_PIN) && defined(PULSE_MODE_PPS)
+#if defined(ARDUINO_ARCH_AVR)
+ISR(TIMER1_COMPB_vect) {
+  if (remaining_ticks > 0)
+    pulse_generator::step();
+  else {
+    TIMSK1 &= ~_BV(OCIE1B);
+    pulse_generator::fire();
+  }
+}
+#elif defined(ARDUINO_ARCH_MEGAAVR)
+ISR(TCB2_INT_vect) {
+  TCB2.INTFLAGS = TCB_CAPT_bm;
+  if (remaining_ticks > 0)
+    pulse_generator::step();
+  else {
+    TCB2.CTRLA = 0;
+    TCB2.INTCTRL = 0;
+    pulse_generator::fire();
+  }
+}
+#elif defined(ARDUINO_ARCH_SAMD)
+void TC4_Handler() {
+  TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  TC4->COUNT16.CTRLA.bit.ENABLE = 0;
+  pulse_generator::fire();
+}
+#endif
+#endif
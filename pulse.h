@@ -0,0 +1,39 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __PULSE_H
+#define __PULSE_H
+
+#include <Arduino.h>
+
+// Drives an output pin from the local clock, either with a pulse at the start of every second or
+// with a square wave, for use by other equipment. Edges are produced by a hardware timer so that
+// they do not vary with the amount of work done by other tasks. An optional second pin indicates
+// whether the clock is locked to GPS time or is in holdover.
+class pulse_generator {
+public:
+  pulse_generator();
+  void arm(uint32_t delay_us);
+  void set_locked(bool locked);
+
+  // Invoked only by interrupt handlers.
+  static void fire();
+  static void step();
+
+private:
+  static void start(uint32_t delay_us);
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ring.h"
+
+static const uint8_t RING_MASK = RING_BUFFER_SIZE - 1;
+
+ring_buffer::ring_buffer()
+  : head(0),
+    tail(0),
+    high_water(0),
+    overflows(0) {
+}
+
+bool ring_buffer::put(uint8_t b) {
+  uint8_t next = (head + 1) & RING_MASK;
+  if (next == tail) {
+    ++overflows;
+    return false;
+  }
+  buffer[head] = b;
+  head = next;
+
+  uint8_t n = (head - tail) & RING_MASK;
+  if (n > high_water)
+    high_water = n;
+  return true;
+}
+
+int ring_buffer::get() {
+  if (head == tail)
+    return -1;
+  uint8_t b = buffer[tail];
+  tail = (tail + 1) & RING_MASK;
+  return b;
+}
+
+int ring_buffer::peek() const {
+  return head == tail ? -1 : buffer[tail];
+}
+
+uint8_t ring_buffer::size() const {
+  return (head - tail) & RING_MASK;
+}
+
+uint8_t ring_buffer::get_high_water() const {
+  return high_water;
+}
+
+uint16_t ring_buffer::get_overflows() const {
+  // Reading 16 bits is not atomic on 8-bit boards.
+  noInterrupts();
+  uint16_t n = overflows;
+  interrupts();
+  return n;
+}
+
+void ring_buffer::clear() {
+  noInterrupts();
+  head = tail = 0;
+  interrupts();
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __RING_H
+#define __RING_H
+
+#include <Arduino.h>
+
+// Capacity of ring buffer, which must be a power of 2 no larger than 256 so that positions fit in
+// 8 bits. Note that one slot is always left empty to distinguish a full buffer from an empty one.
+//
+// Bytes from the GPS module accumulate while other tasks run, so the buffer must hold whatever
+// arrives during the longest of them, which is a full redraw of GPS information on a 20x4 LCD once
+// a fix is acquired. That rewrites about 120 characters over I2C at 100 kHz, at roughly 0.5 ms
+// each, during which about 230 bytes arrive at 38400 baud. At higher rates, the buffer still holds
+// the entire burst of RMC and GGA sentences sent each second by a configured module, which is
+// about 150 bytes. The high water mark is shown with diagnostics on the GPS display.
+static const uint16_t RING_BUFFER_SIZE = 256;
+
+// Byte buffer filled by an interrupt handler and drained by the main loop. It also keeps track of
+// how close it has come to filling up and how many bytes were dropped because it was full.
+class ring_buffer {
+public:
+  ring_buffer();
+  bool put(uint8_t b);
+  int get();
+  int peek() const;
+  uint8_t size() const;
+  uint8_t get_high_water() const;
+  uint16_t get_overflows() const;
+  void clear();
+
+private:
+  volatile uint8_t buffer[RING_BUFFER_SIZE];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  volatile uint8_t high_water;
+  volatile uint16_t overflows;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <Wire.h>
+#include "rtc.h"
+#include "civil.h"
+#include "config.h"
+
+// Registers of the DS3231, where time is stored as BCD in consecutive registers starting with
+// seconds.
+static const uint8_t REG_TIME = 0x00;
+static const uint8_t REG_STATUS = 0x0F;
+static const uint8_t TIME_REGS = 7;
+
+// Bit in the month register indicating that the year has rolled over into the next century.
+static const uint8_t MONTH_CENTURY = 0x80;
+
+// Bit in the hour register indicating 12-hour mode, which this driver never sets but might have
+// been set by other software.
+static const uint8_t HOUR_12 = 0x40;
+static const uint8_t HOUR_PM = 0x20;
+
+// Bit in the status register indicating that the oscillator stopped at some point, e.g. the
+// backup battery was depleted, which means the time is not valid.
+static const uint8_t STATUS_OSF = 0x80;
+
+// Maximum number of milliseconds between successive polls of the seconds register for a change
+// to be considered the start of a second, since a change observed after a longer gap could have
+// happened at any time in between.
+static const uint32_t EDGE_WINDOW_MS = 20;
+
+rtc_clock::rtc_clock()
+  : valid(false),
+    last_second(UINT8_MAX),
+    last_poll_ms(0) {
+  Wire.begin();
+  uint8_t status;
+  valid = read_registers(REG_STATUS, &status, 1) && !(status & STATUS_OSF);
+}
+
+bool rtc_clock::is_valid() {
+  return valid;
+}
+
+bool rtc_clock::read(gps_time& time) {
+  // The start of the second is unknown, so it is presumed to be now, which is no later than the
+  // true start.
+  if (!valid || !read_time(time))
+    return false;
+  time.start_ms = millis();
+  last_second = time.second;
+  last_poll_ms = time.start_ms;
+  return true;
+}
+
+bool rtc_clock::edge(gps_time& time) {
+  // Only the seconds register is polled, and the remaining registers are read once it changes,
+  // which leaves almost a full second before they change again.
+  if (!valid)
+    return false;
+  uint8_t reg;
+  if (!read_registers(REG_TIME, &reg, 1))
+    return false;
+  uint32_t ms = millis();
+  uint8_t second = from_bcd(reg & 0x7F);
+  bool changed = second != last_second && last_second != UINT8_MAX;
+  uint32_t gap_ms = ms - last_poll_ms;
+  last_second = second;
+  last_poll_ms = ms;
+  if (!changed || gap_ms > EDGE_WINDOW_MS || !read_time(time))
+    return false;
+
+  // The change happened at some point since the previous poll.
+  time.start_ms = ms - gap_ms / 2;
+  return true;
+}
+
+bool rtc_clock::write(time_t time) {
+  // Writing the seconds register restarts the countdown to the next second, so the RTC is
+  // aligned with the caller as long as the write happens at the start of a second.
+  civil_time ct = from_epoch(time);
+  uint8_t regs[TIME_REGS] = {
+    to_bcd(ct.second),
+    to_bcd(ct.minute),
+    to_bcd(ct.hour),
+    to_bcd(ct.weekday),
+    to_bcd(ct.day),
+    static_cast<uint8_t>(to_bcd(ct.month) | (ct.year >= 2100 ? MONTH_CENTURY : 0)),
+    to_bcd(ct.year % 100)
+  };
+  if (!write_registers(REG_TIME, regs, TIME_REGS))
+    return false;
+
+  // Clear the oscillator stop flag now that the time is valid.
+  uint8_t status;
+  if (!read_registers(REG_STATUS, &status, 1))
+    return false;
+  status &= ~STATUS_OSF;
+  if (!write_registers(REG_STATUS, &status, 1))
+    return false;
+  valid = true;
+  last_second = ct.second;
+  last_poll_ms = millis();
+  return true;
+}
+
+bool rtc_clock::read_time(gps_time& time) {
+  uint8_t regs[TIME_REGS];
+  if (!read_registers(REG_TIME, regs, TIME_REGS))
+    return false;
+  uint8_t hour;
+  if (regs[2] & HOUR_12) {
+    hour = from_bcd(regs[2] & 0x1F) % 12;
+    if (regs[2] & HOUR_PM)
+      hour += 12;
+  } else
+    hour = from_bcd(regs[2] & 0x3F);
+  time.year = 2000 + from_bcd(regs[6]) + (regs[5] & MONTH_CENTURY ? 100 : 0);
+  time.month = from_bcd(regs[5] & 0x1F);
+  time.day = from_bcd(regs[4] & 0x3F);
+  time.hour = hour;
+  time.minute = from_bcd(regs[1] & 0x7F);
+  time.second = from_bcd(regs[0] & 0x7F);
+  time.nano = 0;
+  time.accuracy_ns = ACCURACY_UNKNOWN;
+
+  // Registers that are out of range indicate an absent or misbehaving device.
+  return time.month >= 1 && time.month <= 12 && time.day >= 1 && time.day <= 31 &&
+    time.hour < 24 && time.minute < 60 && time.second < 60;
+}
+
+bool rtc_clock::read_registers(uint8_t reg, uint8_t* regs, uint8_t count) {
+  Wire.beginTransmission(RTC_I2C_ADDR);
+  Wire.write(reg);
+  if (Wire.endTransmission() != 0 || Wire.requestFrom(RTC_I2C_ADDR, count) != count)
+    return false;
+  for (uint8_t i = 0; i < count; ++i)
+    regs[i] = Wire.read();
+  return true;
+}
+
+bool rtc_clock::write_registers(uint8_t reg, const uint8_t* regs, uint8_t count) {
+  Wire.beginTransmission(RTC_I2C_ADDR);
+  Wire.write(reg);
+  for (uint8_t i = 0; i < count; ++i)
+    Wire.write(regs[i]);
+  return Wire.endTransmission() == 0;
+}
+
+uint8_t rtc_clock::from_bcd(uint8_t value) {
+  return (value >> 4) * 10 + (value & 0x0F);
+}
+
+uint8_t rtc_clock::to_bcd(uint8_t value) {
+  return ((value / 10) << 4) | (value % 10);
+}
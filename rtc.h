@@ -0,0 +1,47 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __RTC_H
+#define __RTC_H
+
+#include <Arduino.h>
+#include <TimeLib.h>
+#include "gps.h"
+
+// Driver for a DS3231 or compatible real-time clock on the I2C bus, which keeps time while the
+// clock is powered off and serves as a secondary source of time when GPS time is unavailable.
+// Since the RTC only resolves whole seconds, the start of a second is found by polling for a
+// change in the seconds register.
+class rtc_clock {
+public:
+  rtc_clock();
+  bool is_valid();
+  bool read(gps_time& time);
+  bool edge(gps_time& time);
+  bool write(time_t time);
+
+private:
+  bool valid;
+  uint8_t last_second;
+  uint32_t last_poll_ms;
+
+  bool read_time(gps_time& time);
+  static bool read_registers(uint8_t reg, uint8_t* regs, uint8_t count);
+  static bool write_registers(uint8_t reg, const uint8_t* regs, uint8_t count);
+  static uint8_t from_bcd(uint8_t value);
+  static uint8_t to_bcd(uint8_t value);
+};
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "scheduler.h"
+
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
+#include <avr/sleep.h>
+#endif
+
+// Number of milliseconds after its deadline that a task may start before the deadline is
+// considered missed.
+static const uint32_t LATE_MS = 5;
+
+// Shift applied to the estimated run time of a task each time a run finishes sooner, which halves
+// the estimate so that a single long run, e.g. a write to EEPROM, is soon forgotten.
+static const uint8_t ESTIMATE_DECAY = 1;
+
+task_scheduler::task_scheduler()
+  : count(0),
+    events(0),
+    held(0),
+    released(0),
+    stats { 0, 0, 0 },
+    window_start_us(micros()),
+    window_idle_us(0),
+    wakes(0) {
+}
+
+uint8_t task_scheduler::add(task_fn fn, uint8_t priority, uint32_t period_ms) {
+  // Periodic tasks first run after one period has elapsed.
+  if (count >= MAX_TASKS)
+    return TASK_NONE;
+  task& t = tasks[count];
+  t.fn = fn;
+  t.period_ms = period_ms;
+  t.due_ms = millis() + period_ms;
+  t.priority = priority;
+  t.armed = period_ms != TASK_EVENT;
+  t.deadline = false;
+  t.estimate_us = 0;
+  t.stats = task_stats { 0, 0, 0, 0, 0 };
+  return count++;
+}
+
+void task_scheduler::schedule(uint8_t id, uint32_t delay_ms) {
+  // An explicit deadline replaces the next periodic deadline, if any.
+  if (id >= count)
+    return;
+  task& t = tasks[id];
+  t.due_ms = millis() + delay_ms;
+  t.armed = true;
+  t.deadline = true;
+}
+
+void task_scheduler::raise(uint8_t id) {
+  // Safe to call from interrupt handlers, since the interrupt state of the caller is restored
+  // rather than interrupts being enabled unconditionally.
+  if (id >= count)
+    return;
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
+  uint8_t sreg = SREG;
+  cli();
+  events |= 1 << id;
+  SREG = sreg;
+#elif defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_MBED)
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  events |= 1 << id;
+  __set_PRIMASK(primask);
+#else
+  noInterrupts();
+  events |= 1 << id;
+  interrupts();
+#endif
+}
+
+bool task_scheduler::run() {
+  // Selects the ready task of highest priority, with ties going to the task added first, and
+  // returns false if no task was ready. A task that is held back gives way to the next ready task,
+  // which may still fit before the deadline.
+  noInterrupts();
+  uint8_t raised = events;
+  interrupts();
+
+  uint32_t ms = millis();
+  uint8_t skipped = 0;
+  int8_t next;
+  do {
+    next = -1;
+    for (uint8_t id = 0; id < count; ++id) {
+      const task& t = tasks[id];
+      if (!(skipped & (1 << id)) && ((raised & (1 << id)) || is_due(t, ms)) &&
+          (next < 0 || t.priority < tasks[next].priority))
+        next = id;
+    }
+    if (next < 0) {
+      idle(raised);
+      return false;
+    }
+    skipped |= 1 << next;
+  } while (!has_slack(next, ms));
+
+  noInterrupts();
+  events &= ~(1 << next);
+  interrupts();
+  dispatch(next, ms);
+  return true;
+}
+
+task_stats task_scheduler::get_stats(uint8_t id) {
+  return tasks[id].stats;
+}
+
+scheduler_stats task_scheduler::get_stats() {
+  return stats;
+}
+
+bool task_scheduler::is_due(const task& t, uint32_t ms) {
+  return t.armed && static_cast<int32_t>(ms - t.due_ms) >= 0;
+}
+
+bool task_scheduler::has_slack(uint8_t id, uint32_t ms) {
+  // A task is held back if, judging by its recent runs, it would still be running when the
+  // deadline of a higher-priority task arrives, unless it was already held back for a deadline
+  // that has since been served.
+  if (released & (1 << id))
+    return true;
+  const task& t = tasks[id];
+  uint32_t run_ms = (t.estimate_us + 999) / 1000;
+  for (uint8_t other_id = 0; other_id < count; ++other_id) {
+    const task& other = tasks[other_id];
+    if (other.priority < t.priority && other.armed && other.deadline &&
+        static_cast<int32_t>(other.due_ms - ms) < static_cast<int32_t>(run_ms)) {
+      held |= 1 << id;
+      return false;
+    }
+  }
+  return true;
+}
+
+void task_scheduler::dispatch(uint8_t id, uint32_t ms) {
+  task& t = tasks[id];
+  task_stats& stats = t.stats;
+
+  if (is_due(t, ms)) {
+    uint32_t late_ms = ms - t.due_ms;
+    if (late_ms > stats.max_late_ms)
+      stats.max_late_ms = late_ms > UINT16_MAX ? UINT16_MAX : late_ms;
+    if (late_ms > LATE_MS && stats.missed < UINT16_MAX)
+      ++stats.missed;
+
+    // Periodic deadlines advance by whole periods so that a task does not drift, unless it has
+    // fallen behind by more than a period. The task may replace its deadline while running.
+    if (t.period_ms != TASK_EVENT) {
+      t.due_ms += t.period_ms;
+      if (static_cast<int32_t>(ms - t.due_ms) >= 0)
+        t.due_ms = ms + t.period_ms;
+    } else
+      t.armed = false;
+
+    // Tasks held back until now are released once an explicit deadline is served.
+    if (t.deadline) {
+      released |= held;
+      held = 0;
+    }
+    t.deadline = false;
+  }
+  released &= ~(1 << id);
+
+  uint32_t start_us = micros();
+  t.fn();
+  uint32_t elapsed_us = micros() - start_us;
+
+  // Estimate follows a longer run immediately but decays after each shorter run.
+  t.estimate_us >>= ESTIMATE_DECAY;
+  if (elapsed_us > t.estimate_us)
+    t.estimate_us = elapsed_us;
+
+  ++stats.runs;
+  stats.total_us += elapsed_us;
+  if (elapsed_us > stats.max_us)
+    stats.max_us = elapsed_us;
+}
+
+void task_scheduler::idle(uint8_t raised) {
+  // Interrupts are disabled while checking for events so that an event raised since the caller
+  // last looked prevents sleep, whereas events that were seen but held back do not.
+  //
+  // Deeper sleep modes are avoided since they stop the timer behind millis(), which is the
+  // timebase of the clock.
+  uint32_t start_us = micros();
+#if defined(ARDUINO_ARCH_AVR)
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (events == raised) {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+#elif defined(ARDUINO_ARCH_MEGAAVR)
+  // Sleep mode is selected in SLPCTRL rather than SMCR on megaAVR parts.
+  cli();
+  if (events == raised) {
+    SLPCTRL.CTRLA = SLPCTRL_SMODE_IDLE_gc | SLPCTRL_SEN_bm;
+    sei();
+    sleep_cpu();
+    SLPCTRL.CTRLA = SLPCTRL_SMODE_IDLE_gc;
+  }
+  sei();
+#elif defined(ARDUINO_ARCH_SAMD) || defined(ARDUINO_ARCH_MBED)
+  __disable_irq();
+  if (events == raised)
+    __WFI();
+  __enable_irq();
+#endif
+  uint32_t end_us = micros();
+  window_idle_us += end_us - start_us;
+  ++wakes;
+  ++stats.wakes;
+
+  // Utilization is the share of the last window not spent sleeping.
+  uint32_t window_us = end_us - window_start_us;
+  if (window_us >= UTILIZATION_WINDOW_MS * 1000) {
+    stats.utilization = 100 - static_cast<uint8_t>(static_cast<uint64_t>(window_idle_us) * 100 / window_us);
+    stats.window_wakes = wakes;
+    window_start_us = end_us;
+    window_idle_us = 0;
+    wakes = 0;
+  }
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <Arduino.h>
+
+// Maximum number of tasks, which is limited by the width of the mask of pending events.
+static const uint8_t MAX_TASKS = 8;
+
+// Identifier returned by `task_scheduler::add()` when no more tasks can be added, which is ignored
+// by the other methods.
+static const uint8_t TASK_NONE = MAX_TASKS;
+
+// Period of a task that only runs when an event is raised or a deadline is scheduled.
+static const uint32_t TASK_EVENT = 0;
+
+typedef void (*task_fn)();
+
+// Number of milliseconds over which utilization is measured.
+static const uint32_t UTILIZATION_WINDOW_MS = 10000;
+
+struct scheduler_stats {
+  uint32_t wakes;
+  uint16_t window_wakes;
+  uint8_t utilization;
+};
+
+struct task_stats {
+  uint32_t runs;
+  uint32_t total_us;
+  uint32_t max_us;
+  uint16_t max_late_ms;
+  uint16_t missed;
+};
+
+// Runs tasks in order of priority, where 0 is highest, as they become ready, either because an
+// event was raised, possibly from an interrupt handler, or because a deadline has arrived.
+// Deadlines set with `schedule()` are protected by holding back lower-priority tasks whose recent
+// run time would otherwise overlap, in which case a shorter ready task of lower priority may run
+// instead, whereas periodic tasks simply run in whatever time remains. A task that was held back
+// always runs once the deadline has been served, so an unusually long run cannot starve it. When no
+// task is ready, the MCU sleeps until the next interrupt, such as receipt of a byte from the GPS
+// module, a PPS edge or the tick of millis(), which keeps running in the shallow sleep modes used
+// here.
+class task_scheduler {
+public:
+  task_scheduler();
+  uint8_t add(task_fn fn, uint8_t priority, uint32_t period_ms);
+  void schedule(uint8_t id, uint32_t delay_ms);
+  void raise(uint8_t id);
+  bool run();
+  task_stats get_stats(uint8_t id);
+  scheduler_stats get_stats();
+
+private:
+  struct task {
+    task_fn fn;
+    uint32_t period_ms;
+    uint32_t due_ms;
+    uint8_t priority;
+    bool armed;
+    bool deadline;
+    uint32_t estimate_us;
+    task_stats stats;
+  };
+
+  task tasks[MAX_TASKS];
+  uint8_t count;
+  volatile uint8_t events;
+  uint8_t held;
+  uint8_t released;
+  scheduler_stats stats;
+  uint32_t window_start_us;
+  uint32_t window_idle_us;
+  uint16_t wakes;
+
+  bool is_due(const task& t, uint32_t ms);
+  bool has_slack(uint8_t id, uint32_t ms);
+  void dispatch(uint8_t id, uint32_t ms);
+  void idle(uint8_t raised);
+};
+
+#endif
@@ -20,10 +20,10 @@
 // adjustment.
 static const uint32_t IDLE_RESET_MS = 10000;
 
-tz_selector::tz_selector(const tz_database* tz_db, const tz_info* tz)
+tz_selector::tz_selector(const tz_database* tz_db, const tz_info& tz)
   : encoder(TZ_A_PIN, TZ_B_PIN, TZ_BUTTON_PIN),
     tz_db(tz_db),
-    tz_confirmed(tz_db->find_index(tz->name)),
+    tz_confirmed(tz.index),
     tz_proposed(tz_confirmed),
     last_action(0) {
   encoder.setDebounceDelay(TZ_DEBOUNCE_MS);
@@ -33,7 +33,10 @@ tz_selector::tz_selector(const tz_database* tz_db, const tz_info* tz)
 tz_action tz_selector::read() {
   if (encoder.push() == 1) {
     // Prioritize button pushes over rotation since rotation can often occur as a side effect of pressing
-    // the button. This ensures that the current selection is confirmed.
+    // the button. This ensures that the current selection is confirmed. A push without any rotation
+    // since the last confirmation has nothing to confirm, so it asks for diagnostics instead.
+    if (last_action == 0)
+      return tz_inspect;
     tz_confirmed = tz_proposed;
     last_action = 0;
     return tz_confirm;
@@ -68,6 +71,6 @@ void tz_selector::reset() {
   last_action = 0;
 }
 
-const tz_info* const tz_selector::get_tz() {
+tz_info tz_selector::get_tz() {
   return tz_db->get(tz_proposed);
 }
@@ -24,15 +24,16 @@ enum tz_action {
   tz_idle,
   tz_propose,
   tz_confirm,
-  tz_reset
+  tz_reset,
+  tz_inspect
 };
 
 class tz_selector {
 public:
-  tz_selector(const tz_database* tz_db, const tz_info* tz);
+  tz_selector(const tz_database* tz_db, const tz_info& tz);
   tz_action read();
   void reset();
-  const tz_info* const get_tz();
+  tz_info get_tz();
 
 private:
   SimpleRotary encoder;
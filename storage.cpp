@@ -29,11 +29,28 @@
 // Defines structure and contents of clock state stored to EEPROM or flash.
 // Note that structure is byte-aligned to ensure backward compatibility with
 // prior technique of reading and writing to EEPROM.
+//
+// Fields following `time_12` were appended without changing the signature,
+// so storage written by prior versions contains arbitrary values in those
+// fields, which must be validated by the consumer. The table of drift versus
+// temperature only exists on boards with a temperature sensor.
 #pragma pack(1)
 struct clock_state {
   uint16_t signature;
   char tz_name[TZ_NAME_SIZE + 1];
   bool time_12;
+  uint32_t gps_baud_rate;
+  uint8_t position_signature;
+  float lat;
+  float lon;
+  float altitude;
+  uint32_t position_time;
+  uint8_t drift_signature;
+  int32_t drift_ppb;
+#if defined(USE_TEMPERATURE_SENSOR)
+  uint8_t table_signature;
+  int32_t table_ppb[DRIFT_BINS];
+#endif
 };
 #pragma pack()
 
@@ -48,6 +65,18 @@ static NanoBLEFlashPrefs flash_storage;
 // Signature expected at head of storage.
 static const uint16_t SIGNATURE = 0x0001;
 
+// Signatures indicating that a last known or surveyed position has been stored.
+static const uint8_t POSITION_KNOWN = 0xA4;
+static const uint8_t POSITION_SURVEYED = 0xA5;
+
+// Signature indicating that an estimate of oscillator drift has been stored.
+static const uint8_t DRIFT_SIGNATURE = 0xA6;
+
+#if defined(USE_TEMPERATURE_SENSOR)
+// Signature indicating that a table of drift versus temperature has been stored.
+static const uint8_t TABLE_SIGNATURE = 0xA7;
+#endif
+
 static char* safe_copy(char* dest, const char* src, size_t count) {
   strncpy(dest, src, count - 1);
   dest[count - 1] = '\0';
@@ -56,8 +85,19 @@ static char* safe_copy(char* dest, const char* src, size_t count) {
 
 local_state::local_state(const clock_state& state)
   : tz_name { '\0' },
-    mode(state.time_12 ? clock_12 : clock_24) {
+    mode(state.time_12 ? clock_12 : clock_24),
+    gps_baud_rate(state.gps_baud_rate),
+    positioned(state.position_signature == POSITION_KNOWN || state.position_signature == POSITION_SURVEYED),
+    surveyed(state.position_signature == POSITION_SURVEYED),
+    position { state.lat, state.lon, state.altitude, 0 },
+    position_time(state.position_time),
+    calibrated(state.drift_signature == DRIFT_SIGNATURE),
+    drift_ppb(state.drift_ppb) {
   safe_copy(const_cast<char*>(this->tz_name), state.tz_name, sizeof(this->tz_name));
+#if defined(USE_TEMPERATURE_SENSOR)
+  compensated = state.table_signature == TABLE_SIGNATURE;
+  memcpy(table.drift_ppb, state.table_ppb, sizeof(table.drift_ppb));
+#endif
 }
 
 local_storage::local_storage() {
@@ -69,6 +109,12 @@ local_storage::local_storage() {
     state.signature = SIGNATURE;
     strcpy(state.tz_name, "UTC");
     state.time_12 = false;
+    state.gps_baud_rate = 0;
+    state.position_signature = 0;
+    state.drift_signature = 0;
+#if defined(USE_TEMPERATURE_SENSOR)
+    state.table_signature = 0;
+#endif
     write_state(state);
   }
 }
@@ -93,6 +139,42 @@ void local_storage::write_mode(clock_mode mode) {
   write_state(state);
 }
 
+void local_storage::write_gps_baud_rate(long baud_rate) {
+  clock_state state;
+  read_state(state);
+  state.gps_baud_rate = baud_rate;
+  write_state(state);
+}
+
+void local_storage::write_position(const gps_info& position, time_t time, bool surveyed) {
+  clock_state state;
+  read_state(state);
+  state.position_signature = surveyed ? POSITION_SURVEYED : POSITION_KNOWN;
+  state.lat = position.lat;
+  state.lon = position.lon;
+  state.altitude = position.altitude;
+  state.position_time = time;
+  write_state(state);
+}
+
+void local_storage::write_drift(int32_t drift_ppb) {
+  clock_state state;
+  read_state(state);
+  state.drift_signature = DRIFT_SIGNATURE;
+  state.drift_ppb = drift_ppb;
+  write_state(state);
+}
+
+#if defined(USE_TEMPERATURE_SENSOR)
+void local_storage::write_table(const drift_table& table) {
+  clock_state state;
+  read_state(state);
+  state.table_signature = TABLE_SIGNATURE;
+  memcpy(state.table_ppb, table.drift_ppb, sizeof(state.table_ppb));
+  write_state(state);
+}
+#endif
+
 void local_storage::read_state(clock_state& state) {
 #if defined(USE_EEPROM_EMULATION)
 #if defined(ARDUINO_SAMD_NANO_33_IOT)
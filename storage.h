@@ -17,7 +17,9 @@
 #define __STORAGE_H
 
 #include <Arduino.h>
+#include "clock.h"
 #include "clockdisplay.h"
+#include "gps.h"
 #include "timezones.h"
 
 struct clock_state;
@@ -26,6 +28,17 @@ class local_state {
 public:
   const char tz_name[TZ_NAME_SIZE + 1];
   clock_mode mode;
+  long gps_baud_rate;
+  bool positioned;
+  bool surveyed;
+  gps_info position;
+  time_t position_time;
+  bool calibrated;
+  int32_t drift_ppb;
+#if defined(USE_TEMPERATURE_SENSOR)
+  bool compensated;
+  drift_table table;
+#endif
 
 private:
   local_state(const clock_state& state);
@@ -38,6 +51,12 @@ public:
   local_state read();
   void write_tz(const char* tz_name);
   void write_mode(clock_mode mode);
+  void write_gps_baud_rate(long baud_rate);
+  void write_position(const gps_info& position, time_t time, bool surveyed);
+  void write_drift(int32_t drift_ppb);
+#if defined(USE_TEMPERATURE_SENSOR)
+  void write_table(const drift_table& table);
+#endif
 
 private:
   void read_state(clock_state& state);
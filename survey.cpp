@@ -0,0 +1,98 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "survey.h"
+#include "config.h"
+
+// Difference in degrees of latitude or longitude, roughly 1 km, beyond which the clock is presumed
+// to have been moved since its position was surveyed.
+static const float MOVED_DEGREES = 0.01;
+
+position_survey::position_survey()
+  : origin {},
+    lat_sum(0.0),
+    lon_sum(0.0),
+    altitude_sum(0.0),
+    samples(0),
+    start_ms(0),
+    complete(false) {
+}
+
+position_survey::position_survey(const gps_info& position)
+  : origin(position),
+    lat_sum(0.0),
+    lon_sum(0.0),
+    altitude_sum(0.0),
+    samples(1),
+    start_ms(0),
+    complete(true) {
+}
+
+bool position_survey::add(const gps_info& info) {
+  if (complete) {
+    if (fabs(info.lat - origin.lat) < MOVED_DEGREES && fabs(info.lon - origin.lon) < MOVED_DEGREES)
+      return false;
+    lat_sum = 0.0;
+    lon_sum = 0.0;
+    altitude_sum = 0.0;
+    samples = 0;
+    complete = false;
+  }
+
+  if (samples == 0) {
+    origin = info;
+    start_ms = millis();
+  } else {
+    lat_sum += info.lat - origin.lat;
+    lon_sum += info.lon - origin.lon;
+    altitude_sum += info.altitude - origin.altitude;
+  }
+  if (samples < UINT16_MAX)
+    ++samples;
+
+  // Survey completes on the first sample after the window has elapsed, at which point the origin
+  // becomes the averaged position.
+  if (millis() - start_ms >= SURVEY_MS) {
+    origin = get_position();
+    lat_sum = 0.0;
+    lon_sum = 0.0;
+    altitude_sum = 0.0;
+    samples = 1;
+    complete = true;
+  }
+  return complete;
+}
+
+bool position_survey::is_complete() {
+  return complete;
+}
+
+gps_info position_survey::get_position() {
+  return gps_info {
+    origin.lat + lat_sum / samples,
+    origin.lon + lon_sum / samples,
+    origin.altitude + altitude_sum / samples,
+    origin.satellites
+  };
+}
+
+void position_survey::apply(gps_info& info) {
+  // Satellites continue to reflect the module, whereas position no longer jitters.
+  if (complete) {
+    info.lat = origin.lat;
+    info.lon = origin.lon;
+    info.altitude = origin.altitude;
+  }
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __SURVEY_H
+#define __SURVEY_H
+
+#include <Arduino.h>
+#include "gps.h"
+
+// Averages the position reported by the GPS module over a period of time, after which the
+// averaged position replaces the position reported by the module. Averaging is done relative to
+// the first position so that precision is not lost on boards where `double` is 32 bits.
+class position_survey {
+public:
+  position_survey();
+  position_survey(const gps_info& position);
+  bool add(const gps_info& info);
+  bool is_complete();
+  gps_info get_position();
+  void apply(gps_info& info);
+
+private:
+  gps_info origin;
+  float lat_sum;
+  float lon_sum;
+  float altitude_sum;
+  uint16_t samples;
+  uint32_t start_ms;
+  bool complete;
+};
+
+#endif
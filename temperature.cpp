@@ -0,0 +1,98 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "temperature.h"
+
+#if defined(ARDUINO_SAMD_NANO_33_IOT)
+// Number of the 32-bit word in the NVM temperature log containing calibration temperatures and
+// ADC readings, respectively.
+static const uint8_t LOG_TEMP = 0;
+static const uint8_t LOG_ADC = 1;
+#endif
+
+temp_monitor::temp_monitor() {
+}
+
+float temp_monitor::read() {
+#if defined(ARDUINO_ARDUINO_NANO33BLE)
+  // The TEMP peripheral reports in units of 0.25 C after a conversion of roughly 36 us.
+  NRF_TEMP->EVENTS_DATARDY = 0;
+  NRF_TEMP->TASKS_START = 1;
+  while (NRF_TEMP->EVENTS_DATARDY == 0)
+    ;
+  NRF_TEMP->EVENTS_DATARDY = 0;
+  int32_t value = NRF_TEMP->TEMP;
+  NRF_TEMP->TASKS_STOP = 1;
+  return value * 0.25f;
+#elif defined(ARDUINO_SAMD_NANO_33_IOT)
+  // The sensor is read through the ADC against the internal 1V reference, and the reading is
+  // mapped to a temperature using calibration values measured at two temperatures during
+  // production. ADC settings are restored afterwards since they are shared with analogRead().
+  const uint32_t* log = reinterpret_cast<const uint32_t*>(NVMCTRL_TEMP_LOG);
+  float room_temp = (log[LOG_TEMP] & 0xFF) + ((log[LOG_TEMP] >> 8) & 0x0F) / 10.0f;
+  float hot_temp = ((log[LOG_TEMP] >> 12) & 0xFF) + ((log[LOG_TEMP] >> 20) & 0x0F) / 10.0f;
+  int32_t room_adc = (log[LOG_ADC] >> 8) & 0x0FFF;
+  int32_t hot_adc = (log[LOG_ADC] >> 20) & 0x0FFF;
+
+  uint8_t refctrl = ADC->REFCTRL.reg;
+  uint32_t inputctrl = ADC->INPUTCTRL.reg;
+  uint16_t ctrlb = ADC->CTRLB.reg;
+  uint8_t avgctrl = ADC->AVGCTRL.reg;
+  uint8_t sampctrl = ADC->SAMPCTRL.reg;
+
+  SYSCTRL->VREF.reg |= SYSCTRL_VREF_TSEN;
+  ADC->REFCTRL.reg = ADC_REFCTRL_REFSEL_INT1V;
+  ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_4 | ADC_AVGCTRL_ADJRES(2);
+  ADC->SAMPCTRL.reg = ADC_SAMPCTRL_SAMPLEN(63);
+  while (ADC->STATUS.bit.SYNCBUSY)
+    ;
+  ADC->CTRLB.reg = (ctrlb & ~ADC_CTRLB_RESSEL_Msk) | ADC_CTRLB_RESSEL_12BIT;
+  while (ADC->STATUS.bit.SYNCBUSY)
+    ;
+  ADC->INPUTCTRL.reg = ADC_INPUTCTRL_MUXPOS_TEMP | ADC_INPUTCTRL_MUXNEG_GND | ADC_INPUTCTRL_GAIN_1X;
+  while (ADC->STATUS.bit.SYNCBUSY)
+    ;
+  ADC->CTRLA.bit.ENABLE = 1;
+  while (ADC->STATUS.bit.SYNCBUSY)
+    ;
+
+  // The first conversion after changing the reference is discarded.
+  int32_t value = 0;
+  for (uint8_t i = 0; i < 2; ++i) {
+    ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY;
+    ADC->SWTRIG.bit.START = 1;
+    while (ADC->INTFLAG.bit.RESRDY == 0)
+      ;
+    value = ADC->RESULT.reg;
+  }
+
+  ADC->CTRLA.bit.ENABLE = 0;
+  while (ADC->STATUS.bit.SYNCBUSY)
+    ;
+  ADC->REFCTRL.reg = refctrl;
+  ADC->INPUTCTRL.reg = inputctrl;
+  ADC->CTRLB.reg = ctrlb;
+  ADC->AVGCTRL.reg = avgctrl;
+  ADC->SAMPCTRL.reg = sampctrl;
+  while (ADC->STATUS.bit.SYNCBUSY)
+    ;
+  SYSCTRL->VREF.reg &= ~SYSCTRL_VREF_TSEN;
+
+  return hot_adc == room_adc ? room_temp :
+    room_temp + (value - room_adc) * (hot_temp - room_temp) / (hot_adc - room_adc);
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __TEMPERATURE_H
+#define __TEMPERATURE_H
+
+#include <Arduino.h>
+#include "board.h"
+
+// Length of time between temperature readings, since the temperature of the board changes slowly.
+static const uint32_t TEMP_READING_MS = 10000;
+
+// Samples the temperature sensor built into the MCU on boards where one is available, which
+// tracks the temperature of the board oscillator closely enough to compensate for its drift.
+class temp_monitor {
+public:
+  temp_monitor();
+  float read();
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Detects the baud rate of a module emitting its default sentences at each standard rate, where
+// bytes are resampled as a UART listening at the wrong rate would see them, and reports how long
+// detection takes when starting from the rate of a prior boot and from some other rate.
+
+#include "gps.h"
+#include "gpssim.h"
+#include "check.h"
+
+static const long RATES[] = { 4800, 9600, 19200, 38400, 57600, 115200 };
+
+// 2025-03-01 12:00:00 UTC.
+static const time_t START_TIME = 1740830400;
+
+// Detects a module emitting at `module_rate`, or nothing at all if zero, starting from `prior_rate`
+// and polling once per millisecond as the boot task does. Returns the detected rate.
+static long detect(long module_rate, long prior_rate, uint32_t& detect_ms) {
+  host::set_us(0);
+  Serial1.reset();
+  gps_unit gps(prior_rate);
+  // Module is already running, so the first burst starts part way through a second.
+  uint32_t next_ms = 300;
+  while (!gps.detect() && millis() < 60000) {
+    if (module_rate != 0 && millis() >= next_ms) {
+      transmit(Serial1, nmea_burst(START_TIME + millis() / 1000, true), host::now_us(), module_rate);
+      next_ms += 1000;
+    }
+    host::advance_us(1000);
+  }
+  detect_ms = gps.get_stats().detect_ms;
+  return gps.get_baud_rate();
+}
+
+int main() {
+  printf("module    from prior  from 9600\n");
+  for (long rate : RATES) {
+    uint32_t prior_ms;
+    uint32_t other_ms;
+    CHECK(detect(rate, rate, prior_ms) == rate);
+    CHECK(detect(rate, rate == 9600 ? 4800 : 9600, other_ms) == rate);
+    CHECK(prior_ms < 2000);
+    printf("%6ld %9u ms %8u ms\n", rate, prior_ms, other_ms);
+  }
+
+  // Rate of a prior boot that is not standard is ignored.
+  uint32_t detect_ms;
+  CHECK(detect(38400, 12345, detect_ms) == 38400);
+
+  // Silent module falls back to the configured rate once every rate has been probed.
+  CHECK(detect(0, 38400, detect_ms) == GPS_BAUD_RATE);
+  printf("silent %9u ms\n", detect_ms);
+  return check_status();
+}
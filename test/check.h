@@ -0,0 +1,40 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CHECK_H
+#define __CHECK_H
+
+#include <stdio.h>
+
+// Number of checks that have failed, which becomes the exit status of a test.
+static int check_failures = 0;
+
+// Reports a failed condition without stopping the test, so that one run reveals every failure.
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      ++check_failures; \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+// Exit status of a test, which reports the number of failed checks.
+static inline int check_status() {
+  if (check_failures > 0)
+    fprintf(stderr, "%d checks failed\n", check_failures);
+  return check_failures > 0 ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks conversions between civil time and seconds since 1970 against the loops of breakTime()
+// and makeTime() in the Time library, which they replace, and against the C library, over every
+// day that a 32-bit time_t on the boards can represent. The incremental calendar is checked at
+// every midnight in that range and at every second of a year that ends in a century without a
+// leap day.
+
+#include "civil.h"
+#include "check.h"
+
+// Last day representable by an unsigned 32-bit time_t, which is 2106-02-07.
+static const int32_t LAST_DAY = static_cast<int32_t>(UINT32_MAX / SECS_PER_DAY);
+
+// Seconds of each day at which conversions are checked, covering the boundaries of every field.
+static const uint32_t DAY_SECONDS[] = { 0, 1, 59, 60, 3599, 3600, 43199, 43200, 86340, 86399 };
+
+// Time of day as broken down by the Time library, where the year is counted from 1970.
+struct time_elements {
+  uint8_t second;
+  uint8_t minute;
+  uint8_t hour;
+  uint8_t wday;
+  uint8_t day;
+  uint8_t month;
+  uint8_t year;
+};
+
+static bool is_leap(uint8_t year) {
+  return !((1970 + year) % 4) && (((1970 + year) % 100) || !((1970 + year) % 400));
+}
+
+static const uint8_t MONTH_DAYS[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// breakTime() of the Time library.
+static time_elements break_time(uint32_t time) {
+  time_elements tm;
+  tm.second = time % 60;
+  time /= 60;
+  tm.minute = time % 60;
+  time /= 60;
+  tm.hour = time % 24;
+  time /= 24;
+  tm.wday = (time + 4) % 7 + 1;
+  uint8_t year = 0;
+  uint32_t days = 0;
+  while ((days += is_leap(year) ? 366 : 365) <= time)
+    ++year;
+  tm.year = year;
+  days -= is_leap(year) ? 366 : 365;
+  time -= days;
+  uint8_t month;
+  for (month = 0; month < 12; ++month) {
+    uint8_t length = month == 1 && is_leap(year) ? 29 : MONTH_DAYS[month];
+    if (time >= length)
+      time -= length;
+    else
+      break;
+  }
+  tm.month = month + 1;
+  tm.day = time + 1;
+  return tm;
+}
+
+// makeTime() of the Time library.
+static uint32_t make_time(const time_elements& tm) {
+  uint32_t seconds = tm.year * (SECS_PER_DAY * 365);
+  for (uint8_t i = 0; i < tm.year; ++i) {
+    if (is_leap(i))
+      seconds += SECS_PER_DAY;
+  }
+  for (uint8_t i = 1; i < tm.month; ++i)
+    seconds += SECS_PER_DAY * (i == 2 && is_leap(tm.year) ? 29 : MONTH_DAYS[i - 1]);
+  seconds += (tm.day - 1) * SECS_PER_DAY;
+  seconds += tm.hour * SECS_PER_HOUR;
+  seconds += tm.minute * SECS_PER_MIN;
+  seconds += tm.second;
+  return seconds;
+}
+
+static bool matches(const civil_time& ct, const time_elements& tm) {
+  return ct.year == 1970 + tm.year && ct.month == tm.month && ct.day == tm.day &&
+    ct.weekday == tm.wday && ct.hour == tm.hour && ct.minute == tm.minute && ct.second == tm.second;
+}
+
+static bool matches(const civil_time& ct, const struct tm& tm) {
+  return ct.year == 1900 + tm.tm_year && ct.month == tm.tm_mon + 1 && ct.day == tm.tm_mday &&
+    ct.weekday == tm.tm_wday + 1 && ct.hour == tm.tm_hour && ct.minute == tm.tm_min &&
+    ct.second == tm.tm_sec;
+}
+
+static bool same(const civil_time& a, const civil_time& b) {
+  return a.year == b.year && a.month == b.month && a.day == b.day && a.weekday == b.weekday &&
+    a.hour == b.hour && a.minute == b.minute && a.second == b.second;
+}
+
+static void test_days() {
+  // Every day round trips, falls on the same weekday and follows the previous day.
+  uint32_t failures = 0;
+  civil_time prev = civil_from_days(-1);
+  for (int32_t days = 0; days <= LAST_DAY; ++days) {
+    civil_time ct = civil_from_days(days);
+    bool next = ct.day == prev.day + 1 ||
+      (ct.day == 1 && (ct.month == prev.month + 1 || (ct.month == 1 && ct.year == prev.year + 1)));
+    if (days_from_civil(ct.year, ct.month, ct.day) != days || !next ||
+        ct.weekday != weekday_from_days(days) || ct.weekday != prev.weekday % 7 + 1)
+      ++failures;
+    prev = ct;
+  }
+  CHECK(failures == 0);
+  CHECK(prev.year == 2106 && prev.month == 2 && prev.day == 7);
+}
+
+static void test_epoch() {
+  // Conversions agree with the Time library and the C library at boundaries of every field of
+  // every day.
+  uint32_t failures = 0;
+  for (int32_t days = 0; days <= LAST_DAY; ++days) {
+    for (uint32_t seconds : DAY_SECONDS) {
+      uint64_t t = static_cast<uint64_t>(days) * SECS_PER_DAY + seconds;
+      if (t > UINT32_MAX)
+        break;
+      civil_time ct = from_epoch(static_cast<time_t>(t));
+      time_elements tm = break_time(static_cast<uint32_t>(t));
+      time_t lt = static_cast<time_t>(t);
+      struct tm ltm;
+      gmtime_r(&lt, &ltm);
+      if (!matches(ct, tm) || !matches(ct, ltm) || make_time(tm) != t || timegm(&ltm) != lt ||
+          to_epoch(ct.year, ct.month, ct.day, ct.hour, ct.minute, ct.second) != lt)
+        ++failures;
+    }
+  }
+  CHECK(failures == 0);
+}
+
+static void test_weekdays() {
+  // 1970-01-01 was a Thursday, 2000-01-01 a Saturday and 2100-03-01 is a Monday.
+  CHECK(from_epoch(0).weekday == 5);
+  CHECK(civil_from_days(days_from_civil(2000, 1, 1)).weekday == 7);
+  CHECK(weekday_from_days(days_from_civil(2100, 3, 1)) == 2);
+  CHECK(days_from_civil(2100, 3, 1) - days_from_civil(2100, 2, 28) == 1);
+  CHECK(days_from_civil(2000, 3, 1) - days_from_civil(2000, 2, 28) == 2);
+}
+
+static void test_midnights() {
+  // Calendar is advanced through the last and first seconds of every day, and then jumps to the
+  // next day, which also recomputes the date.
+  uint32_t failures = 0;
+  civil_calendar calendar;
+  for (int32_t days = 1; days <= LAST_DAY; ++days) {
+    time_t midnight = static_cast<time_t>(days) * SECS_PER_DAY;
+    for (time_t t = midnight - 2; t <= midnight + 2; ++t) {
+      if (!same(calendar.split(t), from_epoch(t)))
+        ++failures;
+    }
+  }
+  CHECK(failures == 0);
+}
+
+static void test_seconds() {
+  // Every second of the year up to 2100-03-01, which follows 2100-02-28, agrees whether advanced
+  // incrementally or converted directly, as do times that go back or skip ahead.
+  uint32_t failures = 0;
+  civil_calendar calendar;
+  time_t start = to_epoch(2099, 3, 1, 0, 0, 0);
+  time_t end = to_epoch(2100, 3, 2, 0, 0, 0);
+  for (time_t t = start; t < end; ++t) {
+    if (!same(calendar.split(t), from_epoch(t)))
+      ++failures;
+  }
+  CHECK(failures == 0);
+  CHECK(calendar.split(end - 1).day == 1);
+  for (time_t t : { end - 5, end - 5, end - 4, end + 3600, static_cast<time_t>(end - SECS_PER_DAY), start, end }) {
+    if (!same(calendar.split(t), from_epoch(t)))
+      ++failures;
+  }
+  CHECK(failures == 0);
+}
+
+int main() {
+  test_days();
+  test_epoch();
+  test_weekdays();
+  test_midnights();
+  test_seconds();
+  return check_status();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Aligns the local clock to PPS edges injected at known times, where the GPS time that labels each
+// second is decoded several hundred milliseconds after the edge, as it is from a real module.
+
+#include "clock.h"
+#include "check.h"
+
+// 2025-03-01 12:00:00 UTC.
+static const time_t START_TIME = 1740830400;
+
+static gps_time label(time_t t, uint32_t start_ms) {
+  civil_time ct = from_epoch(t);
+  return gps_time { ct.year, ct.month, ct.day, ct.hour, ct.minute, ct.second, 0, 0, start_ms };
+}
+
+static void set_ms(uint32_t ms) {
+  host::set_us(static_cast<uint64_t>(ms) * 1000);
+}
+
+// Edge precedes the estimated start of the second, which is typical since the estimate is derived
+// from the arrival of the sentence, and the offset reports how far the estimate lags the edge.
+static void test_edge_before_estimate() {
+  tz_database tz_db;
+  local_clock clock(&tz_db, tz_db.find("UTC"));
+  set_ms(10400);
+  clock.sync(label(START_TIME, 10350), 10000);
+  CHECK(clock.is_sync());
+  CHECK(clock.get_offset() == 350);
+  CHECK(clock.get_phase() == 400);
+  CHECK(clock.until_next() == 600);
+
+  // Second rolls over exactly one second after the edge rather than after the estimate.
+  set_ms(10999);
+  CHECK(clock.get_utc() == START_TIME);
+  set_ms(11000);
+  CHECK(clock.get_utc() == START_TIME + 1);
+  CHECK(clock.tick());
+  CHECK(clock.now().second == 1);
+}
+
+// Edge captured after the sentence was decoded belongs to the following second.
+static void test_edge_of_next_second() {
+  tz_database tz_db;
+  local_clock clock(&tz_db, tz_db.find("UTC"));
+  set_ms(20950);
+  clock.sync(label(START_TIME, 20100), 20900);
+  CHECK(clock.get_offset() == 200);
+  CHECK(clock.get_utc() == START_TIME + 1);
+  CHECK(clock.until_next() == 950);
+  set_ms(21900);
+  CHECK(clock.get_utc() == START_TIME + 2);
+}
+
+// Edge that cannot be matched to the estimated start of the second is ignored in favor of the
+// estimate.
+static void test_edge_ignored() {
+  tz_database tz_db;
+  local_clock clock(&tz_db, tz_db.find("UTC"));
+  set_ms(30500);
+  clock.sync(label(START_TIME, 30400), 29800);
+  CHECK(clock.get_offset() == 0);
+  CHECK(clock.get_phase() == 100);
+}
+
+// Successive edges hold the clock to the pulse, reporting how far the estimate lags behind it.
+static void test_successive_edges() {
+  tz_database tz_db;
+  local_clock clock(&tz_db, tz_db.find("UTC"));
+  for (uint32_t i = 0; i < 10; ++i) {
+    uint32_t edge_ms = 40000 + i * 1000;
+    uint32_t estimate_ms = edge_ms + 200 + i * 10;
+    set_ms(estimate_ms + 100);
+    clock.sync(label(START_TIME + i, estimate_ms), edge_ms);
+    CHECK(clock.get_offset() == static_cast<int32_t>(200 + i * 10));
+    CHECK(clock.get_utc() == START_TIME + i);
+    CHECK(clock.until_next() == 1000 - (estimate_ms + 100 - edge_ms));
+  }
+}
+
+int main() {
+  test_edge_before_estimate();
+  test_edge_of_next_second();
+  test_edge_ignored();
+  test_successive_edges();
+  return check_status();
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gpssim.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+std::string nmea(const std::string& body) {
+  uint8_t checksum = 0;
+  for (char c : body)
+    checksum ^= c;
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  return "$" + body + "*" + HEX_DIGITS[checksum >> 4] + HEX_DIGITS[checksum & 0x0F] + "\r\n";
+}
+
+std::string ubx(uint8_t cls, uint8_t id, const std::string& payload) {
+  std::string frame;
+  frame += static_cast<char>(cls);
+  frame += static_cast<char>(id);
+  frame += static_cast<char>(payload.size() & 0xFF);
+  frame += static_cast<char>(payload.size() >> 8);
+  frame += payload;
+  uint8_t ck_a = 0;
+  uint8_t ck_b = 0;
+  for (char c : frame) {
+    ck_a += static_cast<uint8_t>(c);
+    ck_b += ck_a;
+  }
+  return std::string("\xB5\x62") + frame + static_cast<char>(ck_a) + static_cast<char>(ck_b);
+}
+
+std::string nmea_burst(time_t t, bool fix) {
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char hms[32];
+  char dmy[32];
+  snprintf(hms, sizeof(hms), "%02d%02d%02d.000", tm.tm_hour, tm.tm_min, tm.tm_sec);
+  snprintf(dmy, sizeof(dmy), "%02d%02d%02d", tm.tm_mday, tm.tm_mon + 1, tm.tm_year % 100);
+  std::string h(hms);
+  std::string d(dmy);
+  std::string burst;
+  if (fix) {
+    burst += nmea("GPGGA," + h + ",4530.1234,N,12241.5678,W,1,08,0.95,45.2,M,-19.6,M,,");
+    burst += nmea("GPGSA,A,3,02,05,12,13,15,18,24,25,,,,,1.72,0.95,1.43");
+  } else {
+    burst += nmea("GPGGA," + h + ",,,,,0,00,,,M,,M,,");
+    burst += nmea("GPGSA,A,1,,,,,,,,,,,,,,,");
+  }
+  burst += nmea("GPGSV,3,1,12,02,67,285,44,05,38,071,41,12,55,196,46,13,21,156,38");
+  burst += nmea("GPGSV,3,2,12,15,18,042,35,18,09,321,29,24,47,111,43,25,33,258,40");
+  burst += nmea("GPGSV,3,3,12,26,04,203,,29,12,087,27,31,02,330,,32,01,015,");
+  if (fix) {
+    burst += nmea("GPRMC," + h + ",A,4530.1234,N,12241.5678,W,0.02,31.66," + d + ",,,A");
+    burst += nmea("GPVTG,31.66,T,,M,0.02,N,0.04,K,A");
+  } else {
+    burst += nmea("GPRMC," + h + ",V,,,,,0.00,0.00," + d + ",,,N");
+    burst += nmea("GPVTG,,T,,M,0.00,N,0.00,K,N");
+  }
+  return burst;
+}
+
+// Level of the line at the given time, where the transmission is idle (high) before and after.
+static bool level(const std::string& bytes, double t_us, double bit_us) {
+  if (t_us < 0)
+    return true;
+  size_t bit = static_cast<size_t>(t_us / bit_us);
+  size_t index = bit / 10;
+  if (index >= bytes.size())
+    return true;
+  size_t pos = bit % 10;
+  if (pos == 0)
+    return false;
+  if (pos == 9)
+    return true;
+  return (static_cast<uint8_t>(bytes[index]) >> (pos - 1)) & 1;
+}
+
+std::vector<arrival> resample(const std::string& bytes, uint64_t at_us, unsigned long tx_baud, unsigned long rx_baud) {
+  std::vector<arrival> out;
+  double tx_bit_us = 1e6 / tx_baud;
+  double rx_bit_us = 1e6 / rx_baud;
+  double end_us = bytes.size() * 10 * tx_bit_us;
+
+  // Falling edges are found with a resolution of 1/16 of a bit at the receiving rate, as a UART
+  // would.
+  double step_us = rx_bit_us / 16;
+  double t = 0;
+  while (t < end_us) {
+    if (level(bytes, t, tx_bit_us) || !level(bytes, t - step_us, tx_bit_us)) {
+      t += step_us;
+      continue;
+    }
+    // Start bit must still be low in the middle, otherwise the edge was noise.
+    if (level(bytes, t + rx_bit_us / 2, tx_bit_us)) {
+      t += step_us;
+      continue;
+    }
+    uint8_t b = 0;
+    for (int i = 0; i < 8; ++i) {
+      if (level(bytes, t + (i + 1.5) * rx_bit_us, tx_bit_us))
+        b |= 1 << i;
+    }
+    // Framing errors are not reported by the Arduino core, so the byte is kept regardless of the
+    // stop bit.
+    double stop_us = t + 9.5 * rx_bit_us;
+    out.push_back(arrival { at_us + static_cast<uint64_t>(stop_us), b });
+    t = stop_us;
+  }
+  return out;
+}
+
+void transmit(HardwareSerial& serial, const std::string& bytes, uint64_t at_us, unsigned long tx_baud) {
+  if (serial.get_baud_rate() == tx_baud) {
+    serial.receive(bytes, at_us, tx_baud);
+  } else if (serial.get_baud_rate() != 0) {
+    for (const arrival& a : resample(bytes, at_us, tx_baud, serial.get_baud_rate()))
+      serial.receive(a.b, a.at_us);
+  }
+}
+
+static std::string from_hex(const std::string& hex) {
+  std::string bytes;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2)
+    bytes += static_cast<char>(strtoul(hex.substr(i, 2).c_str(), nullptr, 16));
+  return bytes;
+}
+
+bool read_capture(const char* path, std::vector<capture_line>& lines) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream fields(line);
+    capture_line entry;
+    std::string data;
+    fields >> entry.ms >> data;
+    if (data == "ubx") {
+      std::string hex;
+      fields >> hex;
+      entry.bytes = from_hex(hex);
+    } else {
+      entry.bytes = data + "\r\n";
+    }
+    lines.push_back(entry);
+  }
+  return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __GPSSIM_H
+#define __GPSSIM_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+// Sentence with the leading $, checksum and line termination added to the given body.
+std::string nmea(const std::string& body);
+
+// Frame with sync characters, header and checksum added to the given payload.
+std::string ubx(uint8_t cls, uint8_t id, const std::string& payload);
+
+// Sentences emitted in one second by a module with its default output, i.e. GGA, GSA, three GSV, RMC
+// and VTG, labeled with the given time, where a position is only reported if `fix` is true.
+std::string nmea_burst(time_t t, bool fix);
+
+// Bytes decoded by a receiver at `rx_baud` from a transmission at `tx_baud` that starts at the given
+// time, along with the time each byte is decoded. Bytes are framed as 8N1 and sent back to back,
+// and the receiver samples the middle of each bit after the falling edge of a start bit, which is
+// how a UART listening at the wrong rate turns a sentence into garbage.
+struct arrival {
+  uint64_t at_us;
+  uint8_t b;
+};
+
+std::vector<arrival> resample(const std::string& bytes, uint64_t at_us, unsigned long tx_baud, unsigned long rx_baud);
+
+// Transmits bytes to the serial interface starting at the given time, which are received intact
+// only if the interface listens at the rate at which they are sent.
+void transmit(HardwareSerial& serial, const std::string& bytes, uint64_t at_us, unsigned long tx_baud);
+
+// Timestamped line of a capture file, which is either an NMEA sentence without its line
+// termination, or the hexadecimal bytes of a UBX frame prefixed with "ubx".
+struct capture_line {
+  uint32_t ms;
+  std::string bytes;
+};
+
+// Reads a capture in which each line is the number of milliseconds since the capture started,
+// followed by a space and the sentence or frame. Blank lines and lines starting with # are
+// ignored.
+bool read_capture(const char* path, std::vector<capture_line>& lines);
+
+#endif
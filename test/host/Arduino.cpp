@@ -0,0 +1,167 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Arduino.h"
+
+static uint64_t sim_us = 0;
+
+namespace host {
+uint64_t now_us() {
+  return sim_us;
+}
+
+void set_us(uint64_t us) {
+  sim_us = us;
+}
+
+void advance_us(uint64_t us) {
+  sim_us += us;
+}
+}
+
+uint32_t millis() {
+  return static_cast<uint32_t>(sim_us / 1000);
+}
+
+uint32_t micros() {
+  return static_cast<uint32_t>(sim_us);
+}
+
+void delay(uint32_t ms) {
+  sim_us += static_cast<uint64_t>(ms) * 1000;
+}
+
+void delayMicroseconds(uint32_t us) {
+  sim_us += us;
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+}
+
+int digitalRead(uint8_t) {
+  return HIGH;
+}
+
+int analogRead(uint8_t) {
+  return 0;
+}
+
+void attachInterrupt(uint8_t, void (*)(), int) {
+}
+
+size_t Print::write(const uint8_t* buf, size_t len) {
+  for (size_t i = 0; i < len; ++i)
+    write(buf[i]);
+  return len;
+}
+
+size_t Print::print(const char* s) {
+  return write(reinterpret_cast<const uint8_t*>(s), strlen(s));
+}
+
+size_t Print::print(char c) {
+  return write(static_cast<uint8_t>(c));
+}
+
+size_t Print::print(long n) {
+  return print(std::to_string(n).c_str());
+}
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+HardwareSerial::HardwareSerial()
+  : baud_rate(0),
+    dropped(0) {
+}
+
+void HardwareSerial::begin(unsigned long baud_rate) {
+  // Bytes already received are kept, as they are by the real thing.
+  this->baud_rate = baud_rate;
+}
+
+void HardwareSerial::end() {
+  baud_rate = 0;
+}
+
+int HardwareSerial::available() {
+  deliver();
+  return buffer.size();
+}
+
+int HardwareSerial::read() {
+  deliver();
+  if (buffer.empty())
+    return -1;
+  uint8_t b = buffer.front();
+  buffer.pop_front();
+  return b;
+}
+
+int HardwareSerial::peek() {
+  deliver();
+  return buffer.empty() ? -1 : buffer.front();
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+  if (listener)
+    listener(b);
+  return 1;
+}
+
+HardwareSerial::operator bool() const {
+  return true;
+}
+
+void HardwareSerial::receive(uint8_t b, uint64_t at_us) {
+  // Arrivals must be given in order of time.
+  line.push_back(arrival { at_us, b });
+}
+
+void HardwareSerial::receive(const std::string& bytes, uint64_t at_us, unsigned long baud_rate) {
+  // Each byte arrives once its stop bit has been received, where a byte occupies 10 bits.
+  uint64_t byte_us = 10000000 / baud_rate;
+  for (size_t i = 0; i < bytes.size(); ++i)
+    receive(bytes[i], at_us + (i + 1) * byte_us);
+}
+
+void HardwareSerial::reset() {
+  line.clear();
+  buffer.clear();
+  dropped = 0;
+}
+
+unsigned long HardwareSerial::get_baud_rate() const {
+  return baud_rate;
+}
+
+uint32_t HardwareSerial::get_dropped() const {
+  return dropped;
+}
+
+void HardwareSerial::deliver() {
+  // Bytes are moved into the receive buffer as simulated time reaches them, which is what the
+  // receive interrupt would have done in the meantime.
+  while (!line.empty() && line.front().at_us <= sim_us) {
+    if (buffer.size() < SERIAL_RX_BUFFER_SIZE - 1)
+      buffer.push_back(line.front().b);
+    else
+      ++dropped;
+    line.pop_front();
+  }
+}
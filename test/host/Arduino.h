@@ -0,0 +1,144 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+// Just enough of the Arduino core to run the clock's sources on the host, where time is simulated
+// and only advances when a test says so, and the serial interface is fed by the test rather than
+// a GPS module.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <deque>
+#include <functional>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(p) (*reinterpret_cast<const uint8_t*>(p))
+#define pgm_read_word(p) (*reinterpret_cast<const uint16_t*>(p))
+#define pgm_read_dword(p) (*reinterpret_cast<const uint32_t*>(p))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+
+#define noInterrupts()
+#define interrupts()
+
+#define SERIAL_RX_BUFFER_SIZE 64
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*fn)(), int mode);
+#define digitalPinToInterrupt(pin) (pin)
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  size_t write(const uint8_t* buf, size_t len);
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(long n);
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// Serial interface whose receiver is fed by the test with bytes that arrive at given times, which
+// only become available once simulated time reaches them. Like the real thing, bytes arriving to
+// a full receive buffer are lost. Bytes written are passed to an optional listener, which allows
+// a test to play the part of the GPS module.
+class HardwareSerial : public Stream {
+public:
+  HardwareSerial();
+  void begin(unsigned long baud_rate);
+  void end();
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t b) override;
+  using Print::write;
+  operator bool() const;
+
+  // Used only by tests.
+  void receive(uint8_t b, uint64_t at_us);
+  void receive(const std::string& bytes, uint64_t at_us, unsigned long baud_rate);
+  void reset();
+  unsigned long get_baud_rate() const;
+  uint32_t get_dropped() const;
+  std::function<void(uint8_t)> listener;
+
+private:
+  struct arrival {
+    uint64_t at_us;
+    uint8_t b;
+  };
+
+  std::deque<arrival> line;
+  std::deque<uint8_t> buffer;
+  unsigned long baud_rate;
+  uint32_t dropped;
+
+  void deliver();
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+// Simulated time in microseconds since reset, which tests advance explicitly.
+namespace host {
+uint64_t now_us();
+void set_us(uint64_t us);
+void advance_us(uint64_t us);
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Wire.h"
+
+// Status returned by endTransmission() when the address is not acknowledged.
+static const uint8_t NACK_ADDR = 2;
+
+TwoWire Wire;
+
+TwoWire::TwoWire()
+  : device(nullptr),
+    device_addr(0),
+    tx_addr(0) {
+}
+
+void TwoWire::begin() {
+}
+
+void TwoWire::setClock(uint32_t) {
+}
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  tx_addr = addr;
+  tx.clear();
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  if (device == nullptr || tx_addr != device_addr)
+    return NACK_ADDR;
+  device->write(tx.data(), tx.size());
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t count) {
+  rx.clear();
+  if (device == nullptr || addr != device_addr)
+    return 0;
+  for (uint8_t i = 0; i < count; ++i)
+    rx.push_back(device->read());
+  return count;
+}
+
+int TwoWire::available() {
+  return rx.size();
+}
+
+int TwoWire::read() {
+  if (rx.empty())
+    return -1;
+  uint8_t b = rx.front();
+  rx.pop_front();
+  return b;
+}
+
+int TwoWire::peek() {
+  return rx.empty() ? -1 : rx.front();
+}
+
+size_t TwoWire::write(uint8_t b) {
+  tx.push_back(b);
+  return 1;
+}
+
+void TwoWire::attach(uint8_t addr, i2c_device* device) {
+  device_addr = addr;
+  this->device = device;
+}
+
+void TwoWire::detach() {
+  device = nullptr;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_WIRE_H
+#define __HOST_WIRE_H
+
+#include <vector>
+#include "Arduino.h"
+
+// Device on the simulated I2C bus, which is played by the test. A write delivers every byte of a
+// transmission after the address, and a read supplies the next byte of a request.
+class i2c_device {
+public:
+  virtual ~i2c_device() {}
+  virtual void write(const uint8_t* bytes, size_t count) = 0;
+  virtual uint8_t read() = 0;
+};
+
+// I2C bus on which transmissions and requests are answered by an attached device at the given
+// address, or otherwise fail as they would with nothing connected.
+class TwoWire : public Stream {
+public:
+  TwoWire();
+  void begin();
+  void setClock(uint32_t clock);
+  void beginTransmission(uint8_t addr);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t addr, uint8_t count);
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t b) override;
+  using Print::write;
+
+  // Used only by tests.
+  void attach(uint8_t addr, i2c_device* device);
+  void detach();
+
+private:
+  i2c_device* device;
+  uint8_t device_addr;
+  uint8_t tx_addr;
+  std::vector<uint8_t> tx;
+  std::deque<uint8_t> rx;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the NMEA and UBX parsers side by side on captures of the same module emitting the same
+// fixes in either protocol, given as the two arguments. Reported for each are the bytes received
+// per fix, how many of them precede the time of the fix, which together with the delay before the
+// module starts sending determines how stale the time is once decoded at a given baud rate, and the
+// host time spent parsing per fix.
+//
+// Captures are assumed to start at the beginning of the second labeled by their first time.
+
+#include <chrono>
+#include <vector>
+#include "nmea.h"
+#include "ubx.h"
+#include "gpssim.h"
+
+// Number of times each capture is parsed, where the fastest pass is reported.
+static const int PASSES = 20;
+
+static const unsigned long BAUD_RATES[] = { 9600, 38400, 115200 };
+
+static time_t to_epoch(const gps_fix& fix) {
+  struct tm tm = {};
+  tm.tm_year = fix.year - 1900;
+  tm.tm_mon = fix.month - 1;
+  tm.tm_mday = fix.day;
+  tm.tm_hour = fix.hour;
+  tm.tm_min = fix.minute;
+  tm.tm_sec = fix.second;
+  return timegm(&tm);
+}
+
+template <typename P>
+static void compare(const char* name, const char* path) {
+  std::vector<capture_line> lines;
+  if (!read_capture(path, lines) || lines.empty()) {
+    fprintf(stderr, "%s: cannot read capture\n", path);
+    exit(1);
+  }
+
+  // Counts bytes of each second that precede its time, where the second of a byte is known from
+  // the timestamp of its line.
+  P parser;
+  time_t base = 0;
+  uint32_t fixes = 0;
+  uint32_t bytes = 0;
+  uint32_t burst_second = UINT32_MAX;
+  uint32_t burst_bytes = 0;
+  uint32_t delay_ms = 0;
+  uint64_t before_sum = 0;
+  uint32_t before_max = 0;
+  double nano_sum = 0;
+  for (const capture_line& line : lines) {
+    if (line.ms / 1000 != burst_second) {
+      burst_second = line.ms / 1000;
+      burst_bytes = 0;
+      delay_ms = line.ms % 1000;
+    }
+    for (char c : line.bytes) {
+      ++bytes;
+      ++burst_bytes;
+      if (parser.encode(c) && parser.has_time()) {
+        const gps_fix& fix = parser.get_fix();
+        if (base == 0)
+          base = to_epoch(fix) - burst_second;
+        if (static_cast<uint32_t>(to_epoch(fix) - base) == burst_second) {
+          ++fixes;
+          before_sum += burst_bytes;
+          if (burst_bytes > before_max)
+            before_max = burst_bytes;
+          nano_sum += fix.nano < 0 ? -fix.nano : fix.nano;
+        }
+      }
+    }
+  }
+  if (fixes == 0) {
+    fprintf(stderr, "%s: no fixes decoded\n", path);
+    exit(1);
+  }
+
+  double best_s = 1e9;
+  for (int pass = 0; pass < PASSES; ++pass) {
+    auto start = std::chrono::steady_clock::now();
+    P p;
+    for (const capture_line& line : lines) {
+      for (char c : line.bytes)
+        p.encode(c);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed.count() < best_s)
+      best_s = elapsed.count();
+  }
+
+  double before = static_cast<double>(before_sum) / fixes;
+  printf("%s: %s\n", name, path);
+  printf("  %u fixes, %.1f bytes/fix, %.1f bytes before time (max %u), mean |nano| %.0f ns\n",
+    fixes, static_cast<double>(bytes) / fixes, before, before_max, nano_sum / fixes);
+  printf("  time decoded after:");
+  for (unsigned long baud : BAUD_RATES)
+    printf(" %.1f ms at %lu", delay_ms + before * 10000.0 / baud, baud);
+  printf("\n");
+  printf("  %.0f ns/fix on host\n", best_s * 1e9 / fixes);
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s nmea-capture ubx-capture\n", argv[0]);
+    return 1;
+  }
+  compare<nmea_parser>("nmea", argv[1]);
+  compare<ubx_parser>("ubx", argv[2]);
+  return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Configures a scripted stand-in for the GPS module named by CONFIG_GPS_MODULE, which answers
+// commands as the real module would, emits its default sentences until told otherwise, and can be
+// made to reject commands or ignore a change in baud rate.
+
+#include <set>
+#include <sstream>
+#include "gps.h"
+#include "gpssim.h"
+#include "check.h"
+
+// Delay before the module answers a command.
+static const uint64_t RESPONSE_US = 20000;
+
+// 2025-03-01 12:00:00 UTC.
+static const time_t START_TIME = 1740830400;
+
+class standin {
+public:
+  standin()
+    : baud_rate(9600),
+      ignore_baud(false),
+      rejections(0),
+      busy_us(0) {
+    // Module emits everything by default.
+    for (const char* type : { "GGA", "GLL", "GSA", "GSV", "RMC", "VTG" })
+      enabled.insert(type);
+    Serial1.reset();
+    Serial1.listener = [this](uint8_t b) {
+      // Bytes written at a different rate are garbage to the module.
+      if (Serial1.get_baud_rate() == baud_rate)
+        receive(b);
+    };
+  }
+
+  virtual ~standin() {
+    Serial1.listener = nullptr;
+  }
+
+  // Emits sentences of the given second that are enabled.
+  void emit(time_t t) {
+    std::istringstream burst(nmea_burst(t, true));
+    std::string sentence;
+    std::string out;
+    while (std::getline(burst, sentence)) {
+      if (enabled.count(sentence.substr(3, 3)))
+        out += sentence + "\n";
+    }
+    send(out);
+    emitted += out.size();
+  }
+
+  unsigned long baud_rate;
+  bool ignore_baud;
+  // Number of acknowledged commands that are rejected before commands are accepted again.
+  uint8_t rejections;
+  // Bytes emitted, excluding responses to commands.
+  uint32_t emitted = 0;
+  std::set<std::string> enabled;
+  std::vector<std::string> commands;
+
+protected:
+  void send(const std::string& bytes) {
+    // Output is serialized, so a response waits for anything still being transmitted.
+    uint64_t at_us = host::now_us() > busy_us ? host::now_us() : busy_us;
+    transmit(Serial1, bytes, at_us, baud_rate);
+    busy_us = at_us + bytes.size() * 10000000 / baud_rate;
+  }
+
+  void respond(const std::string& bytes) {
+    if (busy_us < host::now_us() + RESPONSE_US)
+      busy_us = host::now_us() + RESPONSE_US;
+    send(bytes);
+  }
+
+  bool reject() {
+    if (rejections == 0)
+      return false;
+    --rejections;
+    return true;
+  }
+
+  virtual void receive(uint8_t b) = 0;
+
+private:
+  uint64_t busy_us;
+};
+
+#if defined(GPS_MODULE_MTK)
+// MTK module, e.g. the Adafruit Ultimate GPS, which speaks PMTK.
+class module : public standin {
+protected:
+  void receive(uint8_t b) override {
+    line += static_cast<char>(b);
+    if (b != '\n')
+      return;
+    // $PMTKccc,args*hh<CR><LF>
+    std::string body = line.substr(1, line.find('*') - 1);
+    line.clear();
+    std::string cmd = body.substr(4, 3);
+    std::string args = body.size() > 8 ? body.substr(8) : "";
+    commands.push_back(cmd);
+    if (cmd == "251") {
+      // Change in baud rate is not acknowledged.
+      if (!ignore_baud)
+        baud_rate = std::stoul(args);
+      return;
+    }
+    bool rejected = reject();
+    if (cmd == "314" && !rejected) {
+      // Fields correspond to GLL, RMC, VTG, GGA, GSA and GSV.
+      static const char* TYPES[] = { "GLL", "RMC", "VTG", "GGA", "GSA", "GSV" };
+      enabled.clear();
+      for (int i = 0; i < 6; ++i) {
+        if (args[i * 2] != '0')
+          enabled.insert(TYPES[i]);
+      }
+    }
+    respond(nmea("PMTK001," + cmd + "," + (rejected ? "1" : "3")));
+  }
+
+private:
+  std::string line;
+};
+#elif defined(GPS_MODULE_UBLOX)
+// u-blox module, e.g. the NEO-6M, which speaks UBX and is not a timing module.
+class module : public standin {
+protected:
+  void receive(uint8_t b) override {
+    frame += static_cast<char>(b);
+    if (frame.size() == 1 && b != 0xB5)
+      frame.clear();
+    if (frame.size() < 6)
+      return;
+    size_t len = static_cast<uint8_t>(frame[4]) | static_cast<uint8_t>(frame[5]) << 8;
+    if (frame.size() < len + 8)
+      return;
+    uint8_t cls = frame[2];
+    uint8_t id = frame[3];
+    std::string payload = frame.substr(6, len);
+    frame.clear();
+
+    char name[8];
+    snprintf(name, sizeof(name), "%02X-%02X", cls, id);
+    commands.push_back(name);
+    if (cls == 0x06 && id == 0x00) {
+      if (len == 1) {
+        // Poll of port configuration is answered with the configuration.
+        respond(ubx(0x06, 0x00, std::string(20, '\0')));
+      } else if (!ignore_baud) {
+        // Change in port configuration is not acknowledged at the new rate.
+        baud_rate = static_cast<uint8_t>(payload[8]) | static_cast<uint8_t>(payload[9]) << 8 |
+          static_cast<uint8_t>(payload[10]) << 16;
+      }
+      return;
+    }
+    if (cls == 0x0B)
+      return;
+    // NAV-PVT and fixed-position timing mode are unknown to the NEO-6M.
+    bool rejected = (cls == 0x06 && id == 0x3D) ||
+      (cls == 0x06 && id == 0x01 && payload[0] == 0x01 && payload[1] == 0x07) || reject();
+    if (cls == 0x06 && id == 0x01 && payload[0] == static_cast<char>(0xF0) && !rejected) {
+      static const char* TYPES[] = { "GGA", "GLL", "GSA", "GSV", "RMC", "VTG" };
+      uint8_t index = payload[1];
+      if (index < 6) {
+        if (payload[2] != 0)
+          enabled.insert(TYPES[index]);
+        else
+          enabled.erase(TYPES[index]);
+      }
+    }
+    respond(ubx(0x05, rejected ? 0x00 : 0x01, std::string() + static_cast<char>(cls) + static_cast<char>(id)));
+  }
+
+private:
+  std::string frame;
+};
+#endif
+
+// Runs the GPS unit for the given number of milliseconds, where the module emits sentences at the
+// start of each second.
+static void run(gps_unit& gps, module& m, uint32_t ms) {
+  gps_info info;
+  gps_time time;
+  for (uint32_t i = 0; i < ms; ++i) {
+    if (millis() % 1000 == 0)
+      m.emit(START_TIME + millis() / 1000);
+    gps.read(info, time);
+    host::advance_us(1000);
+  }
+}
+
+// Runs the GPS unit until it is no longer busy, returning the number of milliseconds elapsed.
+static uint32_t settle(gps_unit& gps, module& m) {
+  uint32_t start = millis();
+  while (gps.is_busy() && millis() - start < 60000)
+    run(gps, m, 1);
+  return millis() - start;
+}
+
+static void test_configure() {
+  module m;
+  gps_unit gps(9600);
+  run(gps, m, 2000);
+  uint32_t before = m.emitted;
+  gps.configure();
+  uint32_t elapsed = settle(gps, m);
+  CHECK(elapsed < 1000);
+  CHECK(gps.is_configured());
+  CHECK(m.baud_rate == GPS_MODULE_BAUD_RATE);
+  CHECK(Serial1.get_baud_rate() == GPS_MODULE_BAUD_RATE);
+  CHECK(m.enabled == std::set<std::string>({ "GGA", "RMC" }));
+
+  // Sentences continue to be decoded at the new rate with far fewer bytes. RMC and GGA are about a
+  // third of the default output of a GPS-only module tracking 12 satellites, which is the floor,
+  // since RMC alone carries both date and time, and GGA alone carries altitude, satellites and HDOP.
+  run(gps, m, 2000 - millis() % 1000);
+  uint32_t sentences = gps.get_stats().sentences;
+  uint32_t emitted = m.emitted;
+  run(gps, m, 2000);
+  CHECK(gps.get_stats().sentences - sentences == 4);
+  uint32_t reduction = 100 - 100 * (m.emitted - emitted) / before;
+  CHECK(reduction >= 65);
+  printf("configured in %u ms, %u%% fewer bytes per second\n", elapsed, reduction);
+}
+
+static void test_retry() {
+  // Rejections short of the number of attempts are retried.
+  module m;
+  m.rejections = 2;
+  gps_unit gps(9600);
+  gps.configure();
+  settle(gps, m);
+  CHECK(gps.is_configured());
+  CHECK(m.baud_rate == GPS_MODULE_BAUD_RATE);
+
+  // Persistent rejection leaves the module unconfigured, but configuration still runs to the end.
+  module n;
+  n.rejections = 3;
+  gps_unit other(9600);
+  other.configure();
+  settle(other, n);
+  CHECK(!other.is_configured());
+  CHECK(n.baud_rate == GPS_MODULE_BAUD_RATE);
+}
+
+static void test_baud_ignored() {
+  // Module that stays at its original rate is found there again after verification fails.
+  module m;
+  m.ignore_baud = true;
+  gps_unit gps(9600);
+  gps.configure();
+  settle(gps, m);
+  CHECK(!gps.is_configured());
+  CHECK(Serial1.get_baud_rate() == 9600);
+  uint32_t sentences = gps.get_stats().sentences;
+  run(gps, m, 3000);
+  CHECK(gps.get_stats().sentences > sentences);
+}
+
+static void test_position() {
+  // MTK modules accept the static navigation threshold, whereas the NEO-6M rejects the timing mode
+  // and falls back to the stationary dynamic model.
+  module m;
+  gps_unit gps(9600);
+  gps.configure();
+  settle(gps, m);
+  m.commands.clear();
+  gps_info position = { 45.5f, -122.6f, 30.0f, 8 };
+  gps.set_position(position);
+  gps.aid(position, START_TIME);
+  settle(gps, m);
+#if defined(GPS_MODULE_MTK)
+  CHECK(m.commands == std::vector<std::string>({ "386", "741" }));
+#else
+  CHECK(m.commands == std::vector<std::string>({ "06-3D", "06-3D", "06-3D", "06-24", "0B-01" }));
+#endif
+}
+
+static void test_ttff() {
+  // Fixes acquired while the clock is still starting up are not counted, so time to first fix
+  // starts once the module is configured.
+  module m;
+  gps_unit gps(9600);
+  gps.configure();
+  settle(gps, m);
+  run(gps, m, 3000);
+  CHECK(gps.get_stats().ttff_ms == 0);
+  gps.start_ttff();
+  run(gps, m, 3000);
+  CHECK(gps.get_stats().ttff_ms > 0 && gps.get_stats().ttff_ms <= 2000);
+}
+
+int main() {
+  test_configure();
+  test_retry();
+  test_baud_ignored();
+  test_position();
+  test_ttff();
+  return check_status();
+}
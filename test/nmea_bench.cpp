@@ -0,0 +1,106 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures throughput of the NMEA parser on the host, along with TinyGPS++ when it is available,
+// over a capture given as the only argument or, by default, an hour of the sentences a module
+// emits without configuration. Host throughput says nothing absolute about the boards, but the
+// ratio between the parsers is indicative since neither depends on the hardware.
+
+#include <chrono>
+#include <vector>
+#include "nmea.h"
+#include "gpssim.h"
+#if defined(USE_TINYGPS)
+#include <TinyGPS++.h>
+#endif
+
+// Number of seconds of sentences synthesized when no capture is given.
+static const time_t SYNTHETIC_S = 3600;
+
+// Number of times the input is parsed, where the fastest pass is reported.
+static const int PASSES = 10;
+
+// 2025-03-01 12:00:00 UTC.
+static const time_t START_TIME = 1740830400;
+
+struct result {
+  double best_s;
+  uint32_t sentences;
+};
+
+template <typename F>
+static result measure(const std::string& input, F parse) {
+  result r { 1e9, 0 };
+  for (int pass = 0; pass < PASSES; ++pass) {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t sentences = parse(input);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed.count() < r.best_s)
+      r.best_s = elapsed.count();
+    r.sentences = sentences;
+  }
+  return r;
+}
+
+static void report(const char* name, const std::string& input, const result& r) {
+  printf("%-10s %10u sentences %8.1f MB/s %8.2f ns/byte\n", name, r.sentences,
+    input.size() / r.best_s / 1e6, r.best_s * 1e9 / input.size());
+}
+
+int main(int argc, char** argv) {
+  std::string input;
+  if (argc > 1) {
+    std::vector<capture_line> lines;
+    if (!read_capture(argv[1], lines)) {
+      fprintf(stderr, "%s: cannot read capture\n", argv[1]);
+      return 1;
+    }
+    for (const capture_line& line : lines)
+      input += line.bytes;
+  } else {
+    for (time_t t = 0; t < SYNTHETIC_S; ++t)
+      input += nmea_burst(START_TIME + t, t >= 30);
+  }
+  printf("%zu bytes\n", input.size());
+
+  result nmea = measure(input, [](const std::string& in) {
+    nmea_parser parser;
+    uint32_t decoded = 0;
+    for (char c : in) {
+      if (parser.encode(c))
+        ++decoded;
+    }
+    return decoded;
+  });
+  report("nmea", input, nmea);
+
+#if defined(USE_TINYGPS)
+  result tiny = measure(input, [](const std::string& in) {
+    TinyGPSPlus parser;
+    uint32_t decoded = 0;
+    for (char c : in) {
+      if (parser.encode(c))
+        ++decoded;
+    }
+    return decoded;
+  });
+  report("tinygps++", input, tiny);
+  printf("speedup %.1fx\n", tiny.best_s / nmea.best_s);
+#else
+  printf("tinygps++ not found, set TINYGPS_DIR to compare\n");
+#endif
+  return 0;
+}
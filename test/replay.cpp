@@ -0,0 +1,145 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays each capture given as an argument through `gps_unit::read()`, polled once per
+// millisecond of simulated time as the GPS task is, and reports transitions between searching and
+// available, along with the first time GPS information is withheld for each reason in between, and
+// finally bytes and sentences per second and a histogram of the host time spent per call.
+
+#include <chrono>
+#include "gps.h"
+#include "gpssim.h"
+
+// Rate at which captures were transmitted.
+static const unsigned long CAPTURE_BAUD_RATE = 9600;
+
+// Upper bounds in nanoseconds of all but the last bucket of the histogram of host time per call.
+static const uint32_t HOST_BOUNDS_NS[] = { 250, 500, 1000, 2000, 5000, 10000 };
+static const uint8_t HOST_BUCKETS = sizeof(HOST_BOUNDS_NS) / sizeof(HOST_BOUNDS_NS[0]) + 1;
+
+static const char* to_string(gps_state state) {
+  switch (state) {
+    case gps_searching:
+      return "searching";
+    case gps_available:
+      return "available";
+    case gps_time_only:
+      return "time only";
+    case gps_degraded:
+      return "degraded";
+    default:
+      return "ignore";
+  }
+}
+
+static const char* to_string(gps_gate gate) {
+  switch (gate) {
+    case gate_no_fix:
+      return "no fix";
+    case gate_stale:
+      return "stale";
+    case gate_hdop:
+      return "hdop";
+    case gate_inconsistent:
+      return "inconsistent";
+    default:
+      return "ok";
+  }
+}
+
+static bool replay(const char* path) {
+  std::vector<capture_line> lines;
+  if (!read_capture(path, lines) || lines.empty()) {
+    fprintf(stderr, "%s: cannot read capture\n", path);
+    return false;
+  }
+  printf("%s\n", path);
+
+  // Every line is queued up front, arriving as simulated time passes.
+  host::set_us(0);
+  Serial1.reset();
+  gps_unit gps(CAPTURE_BAUD_RATE);
+  for (const capture_line& line : lines)
+    Serial1.receive(line.bytes, static_cast<uint64_t>(line.ms) * 1000, CAPTURE_BAUD_RATE);
+  uint32_t end_ms = lines.back().ms + 1000;
+
+  gps_state last = gps_ignore;
+  gps_gate last_gate = gate_ok;
+  uint32_t calls = 0;
+  uint32_t histogram[HOST_BUCKETS] = {};
+  double total_ns = 0;
+  gps_info info;
+  gps_time time;
+  while (millis() < end_ms) {
+    auto start = std::chrono::steady_clock::now();
+    gps_state state = gps.read(info, time);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+    ++calls;
+    total_ns += elapsed.count();
+    uint8_t bucket = 0;
+    while (bucket < HOST_BUCKETS - 1 && elapsed.count() >= HOST_BOUNDS_NS[bucket])
+      ++bucket;
+    ++histogram[bucket];
+
+    // Degraded and searching alternate while the fix is lost, since the former is returned for each
+    // sentence and the latter in between, so only the reason for being degraded is tracked.
+    bool changed = state == gps_degraded ? gps.get_gate() != last_gate :
+      state != gps_ignore && state != last && (state != gps_searching || last != gps_degraded);
+    if (changed) {
+      printf("  %8.3f s  %s", millis() / 1000.0, to_string(state));
+      if (state == gps_degraded)
+        printf(" (%s)", to_string(gps.get_gate()));
+      if (state == gps_available || state == gps_time_only)
+        printf("  %04u-%02u-%02u %02u:%02u:%02u", time.year, time.month, time.day, time.hour,
+          time.minute, time.second);
+      printf("\n");
+    }
+    if (state != gps_ignore && (state != gps_searching || last != gps_degraded))
+      last = state;
+    if (state == gps_degraded)
+      last_gate = gps.get_gate();
+    else if (state == gps_available || state == gps_time_only)
+      last_gate = gate_ok;
+    host::advance_us(1000);
+  }
+
+  gps_stats stats = gps.get_stats();
+  double seconds = end_ms / 1000.0;
+  printf("  %.1f bytes/s, %.2f sentences/s, %u checksum errors, %u overflows, %u dropped by gate\n",
+    stats.bytes / seconds, stats.sentences / seconds, stats.checksum_errors, Serial1.get_dropped(),
+    stats.dropped);
+  printf("  %u calls, %.0f ns/call on host:", calls, total_ns / calls);
+  for (uint8_t i = 0; i < HOST_BUCKETS; ++i) {
+    if (i < HOST_BUCKETS - 1)
+      printf(" <%u:%u", HOST_BOUNDS_NS[i], histogram[i]);
+    else
+      printf(" >=%u:%u", HOST_BOUNDS_NS[i - 1], histogram[i]);
+  }
+  printf("\n");
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s capture...\n", argv[0]);
+    return 1;
+  }
+  bool ok = true;
+  for (int i = 1; i < argc; ++i)
+    ok = replay(argv[i]) && ok;
+  return ok ? 0 : 1;
+}
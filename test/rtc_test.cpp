@@ -0,0 +1,301 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reads and writes a simulated DS3231 through the RTC driver, finds the start of its seconds by
+// polling, and holds the local clock to it for hours without GPS time, as at boot and during
+// holdover.
+
+#include "rtc.h"
+#include "clock.h"
+#include <Wire.h>
+#include "check.h"
+
+// 2025-03-01 12:00:00 UTC.
+static const time_t START_TIME = 1740830400;
+
+// Registers of the DS3231 and bits thereof that the driver relies on.
+static const uint8_t REGS = 0x13;
+static const uint8_t REG_STATUS = 0x0F;
+static const uint8_t TIME_REGS = 7;
+static const uint8_t MONTH_CENTURY = 0x80;
+static const uint8_t HOUR_12 = 0x40;
+static const uint8_t HOUR_PM = 0x20;
+static const uint8_t STATUS_OSF = 0x80;
+
+// Stand-in for a DS3231, whose seconds count from the last write of the time registers at a rate
+// that is off by the given parts per million. Time is kept in 24-hour mode unless told otherwise,
+// and the remaining registers hold whatever was last written.
+class ds3231 : public i2c_device {
+public:
+  ds3231(time_t time, bool stopped)
+    : base_time(time),
+      base_us(host::now_us()),
+      drift_ppm(0),
+      twelve_hour(false),
+      reg(0) {
+    memset(regs, 0, sizeof(regs));
+    regs[REG_STATUS] = stopped ? STATUS_OSF : 0;
+    Wire.attach(RTC_I2C_ADDR, this);
+  }
+
+  ~ds3231() {
+    Wire.detach();
+  }
+
+  time_t now() const {
+    double elapsed_s = (host::now_us() - base_us) * (1 + drift_ppm / 1e6) / 1e6;
+    return base_time + static_cast<time_t>(elapsed_s);
+  }
+
+  void write(const uint8_t* bytes, size_t count) override {
+    reg = bytes[0];
+    for (size_t i = 1; i < count; ++i)
+      regs[(reg + i - 1) % REGS] = bytes[i];
+    if (reg == 0 && count > TIME_REGS) {
+      // Writing the time restarts the countdown to the next second.
+      struct tm tm = {};
+      tm.tm_sec = from_bcd(regs[0]);
+      tm.tm_min = from_bcd(regs[1]);
+      tm.tm_hour = from_bcd(regs[2] & 0x3F);
+      tm.tm_mday = from_bcd(regs[4]);
+      tm.tm_mon = from_bcd(regs[5] & 0x1F) - 1;
+      tm.tm_year = 100 + from_bcd(regs[6]) + (regs[5] & MONTH_CENTURY ? 100 : 0);
+      base_time = timegm(&tm);
+      base_us = host::now_us();
+    }
+  }
+
+  uint8_t read() override {
+    if (reg < TIME_REGS)
+      update();
+    uint8_t b = regs[reg];
+    reg = (reg + 1) % REGS;
+    return b;
+  }
+
+  time_t base_time;
+  uint64_t base_us;
+  double drift_ppm;
+  bool twelve_hour;
+  uint8_t regs[REGS];
+
+private:
+  uint8_t reg;
+
+  void update() {
+    time_t t = now();
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    regs[0] = to_bcd(tm.tm_sec);
+    regs[1] = to_bcd(tm.tm_min);
+    if (twelve_hour) {
+      uint8_t hour = tm.tm_hour % 12 == 0 ? 12 : tm.tm_hour % 12;
+      regs[2] = HOUR_12 | (tm.tm_hour >= 12 ? HOUR_PM : 0) | to_bcd(hour);
+    } else
+      regs[2] = to_bcd(tm.tm_hour);
+    regs[4] = to_bcd(tm.tm_mday);
+    regs[5] = to_bcd(tm.tm_mon + 1) | (tm.tm_year >= 200 ? MONTH_CENTURY : 0);
+    regs[6] = to_bcd(tm.tm_year % 100);
+  }
+
+  static uint8_t from_bcd(uint8_t value) {
+    return (value >> 4) * 10 + (value & 0x0F);
+  }
+
+  static uint8_t to_bcd(int value) {
+    return ((value / 10) << 4) | (value % 10);
+  }
+};
+
+static bool matches(const gps_time& time, time_t t) {
+  return to_epoch(time.year, time.month, time.day, time.hour, time.minute, time.second) == t;
+}
+
+static void set_ms(uint32_t ms) {
+  host::set_us(static_cast<uint64_t>(ms) * 1000);
+}
+
+static void test_absent() {
+  // Nothing answers on the bus.
+  rtc_clock rtc;
+  gps_time time;
+  CHECK(!rtc.is_valid());
+  CHECK(!rtc.read(time));
+  CHECK(!rtc.write(START_TIME));
+}
+
+static void test_stopped() {
+  // Oscillator stopped while the clock was off, so the time is not trusted until written.
+  set_ms(1000);
+  ds3231 ds(START_TIME, true);
+  rtc_clock rtc;
+  gps_time time;
+  CHECK(!rtc.is_valid());
+  CHECK(!rtc.read(time));
+  CHECK(rtc.write(START_TIME + 3600));
+  CHECK(rtc.is_valid());
+  CHECK(!(ds.regs[REG_STATUS] & STATUS_OSF));
+  CHECK(rtc.read(time));
+  CHECK(matches(time, START_TIME + 3600));
+}
+
+static void test_read_write() {
+  set_ms(1000);
+  ds3231 ds(0, false);
+  rtc_clock rtc;
+  CHECK(rtc.is_valid());
+  CHECK(rtc.write(START_TIME));
+  CHECK(ds.now() == START_TIME);
+  // Weekday of a Saturday, counted from 1 for Sunday.
+  CHECK(ds.regs[3] == 7);
+
+  set_ms(2500);
+  gps_time time;
+  CHECK(rtc.read(time));
+  CHECK(matches(time, START_TIME + 1));
+  CHECK(time.start_ms == 2500);
+  CHECK(time.accuracy_ns == ACCURACY_UNKNOWN);
+
+  // Century is carried by the month register, including across the rollover.
+  time_t before = to_epoch(2099, 12, 31, 23, 59, 59);
+  CHECK(rtc.write(before));
+  CHECK(rtc.read(time));
+  CHECK(matches(time, before));
+  set_ms(3500);
+  CHECK(rtc.read(time));
+  CHECK(time.year == 2100 && time.month == 1 && time.day == 1 && time.hour == 0);
+  CHECK(rtc.write(to_epoch(2100, 3, 1, 0, 0, 0)));
+  CHECK(ds.regs[5] & MONTH_CENTURY);
+}
+
+static void test_12_hour() {
+  // Hours in 12-hour mode, set by other software, are read in 24-hour terms.
+  set_ms(1000);
+  ds3231 ds(START_TIME + 3 * 3600, false);
+  ds.twelve_hour = true;
+  rtc_clock rtc;
+  gps_time time;
+  CHECK(rtc.read(time));
+  CHECK(time.hour == 15);
+  ds.base_time = START_TIME - 12 * 3600;
+  CHECK(rtc.read(time));
+  CHECK(time.hour == 0);
+  ds.base_time = START_TIME;
+  CHECK(rtc.read(time));
+  CHECK(time.hour == 12);
+}
+
+static void test_edge() {
+  // Seconds of the RTC start 437 ms into each second of millis().
+  set_ms(10437);
+  ds3231 ds(START_TIME, false);
+  rtc_clock rtc;
+  gps_time time;
+  set_ms(11000);
+  CHECK(rtc.read(time));
+  CHECK(!rtc.edge(time));
+  bool found = false;
+  while (millis() < 12000 && !found) {
+    host::advance_us(1000);
+    found = rtc.edge(time);
+  }
+  CHECK(found);
+  CHECK(matches(time, START_TIME + 1));
+  CHECK(time.start_ms >= 11436 && time.start_ms <= 11437);
+
+  // Change observed after too long a gap could have happened at any time in between.
+  set_ms(12400);
+  CHECK(!rtc.edge(time));
+  set_ms(12450);
+  CHECK(!rtc.edge(time));
+}
+
+static void test_boot() {
+  // Time is shown as soon as the RTC is read at boot, before the start of a second is known.
+  set_ms(5000);
+  ds3231 ds(START_TIME, false);
+  set_ms(5250);
+  rtc_clock rtc;
+  tz_database tz_db;
+  local_clock clock(&tz_db, tz_db.find("UTC"));
+  gps_time time;
+  CHECK(rtc.read(time));
+  clock.hold(time, 1000);
+  CHECK(clock.is_sync());
+  CHECK(!clock.is_locked());
+  CHECK(clock.tick());
+  CHECK(clock.get_utc() == START_TIME);
+  CHECK(clock.now().second == 0);
+  CHECK(clock.get_uncertainty() >= 1000);
+}
+
+static void test_holdover() {
+  // RTC is written at the start of a second of GPS time, which coincides with the start of a
+  // second of millis(), and then runs 2 ppm fast while the clock is held to it once per minute, as
+  // it would be without GPS time for hours.
+  const uint32_t HOLDOVER_MS = 6 * 3600 * 1000;
+  const uint32_t SYNC_MS = 60000;
+  const double DRIFT_PPM = 2;
+  set_ms(1000);
+  ds3231 ds(0, false);
+  ds.drift_ppm = DRIFT_PPM;
+  rtc_clock rtc;
+  CHECK(rtc.write(START_TIME));
+
+  tz_database tz_db;
+  local_clock clock(&tz_db, tz_db.find("UTC"));
+  gps_time time;
+  uint32_t sync_ms = 0;
+  bool held = false;
+  time_t last = 0;
+  uint32_t skips = 0;
+  int32_t max_error = 0;
+  while (millis() < 1000 + HOLDOVER_MS) {
+    if ((!held || millis() - sync_ms >= SYNC_MS) && rtc.edge(time)) {
+      CHECK(matches(time, ds.now()));
+      clock.hold(time, 10);
+      sync_ms = millis();
+      held = true;
+    }
+    if (clock.tick()) {
+      // Error is how far the start of the second on the clock is from the true start.
+      time_t t = clock.get_utc();
+      if (last != 0 && t != last + 1)
+        ++skips;
+      last = t;
+      int32_t error = static_cast<int32_t>(millis() - 1000) - static_cast<int32_t>(t - START_TIME) * 1000;
+      if (abs(error) > abs(max_error))
+        max_error = error;
+    }
+    host::advance_us(1000);
+  }
+  // Seconds are neither skipped nor repeated, and the error is no worse than that of the RTC.
+  CHECK(skips == 0);
+  int32_t bound = static_cast<int32_t>(HOLDOVER_MS * DRIFT_PPM / 1e6) + 2;
+  CHECK(abs(max_error) <= bound);
+  printf("held for %u h, maximum error %d ms, bound %d ms\n", HOLDOVER_MS / 3600000, max_error, bound);
+}
+
+int main() {
+  test_absent();
+  test_stopped();
+  test_read_write();
+  test_12_hour();
+  test_edge();
+  test_boot();
+  test_holdover();
+  return check_status();
+}
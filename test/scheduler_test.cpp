@@ -0,0 +1,79 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Runs tasks through the scheduler with simulated run times and checks the order in which they run
+// around an explicit deadline.
+
+#include "scheduler.h"
+#include "check.h"
+
+static const uint8_t PRIORITY_DEADLINE = 0;
+static const uint8_t PRIORITY_SLOW = 1;
+static const uint8_t PRIORITY_QUICK = 2;
+
+// Simulated run time of the slow task, which overlaps the deadline.
+static const uint32_t SLOW_US = 50000;
+
+static int deadline_runs;
+static int slow_runs;
+static int quick_runs;
+
+static void deadline_task() {
+  ++deadline_runs;
+}
+
+static void slow_task() {
+  ++slow_runs;
+  host::advance_us(SLOW_US);
+}
+
+static void quick_task() {
+  ++quick_runs;
+  host::advance_us(100);
+}
+
+static void test_fall_through() {
+  // Slow task is held back for the deadline, but the quick task of lower priority fits before it
+  // and runs in the meantime, after which the slow task runs once the deadline is served.
+  task_scheduler sched;
+  uint8_t deadline = sched.add(deadline_task, PRIORITY_DEADLINE, TASK_EVENT);
+  uint8_t slow = sched.add(slow_task, PRIORITY_SLOW, TASK_EVENT);
+  uint8_t quick = sched.add(quick_task, PRIORITY_QUICK, TASK_EVENT);
+  sched.raise(slow);
+  CHECK(sched.run());
+  CHECK(slow_runs == 1);
+
+  sched.schedule(deadline, 10);
+  sched.raise(slow);
+  sched.raise(quick);
+  CHECK(sched.run());
+  CHECK(quick_runs == 1 && slow_runs == 1);
+  CHECK(!sched.run());
+  CHECK(slow_runs == 1);
+
+  host::advance_us(10000);
+  CHECK(sched.run());
+  CHECK(deadline_runs == 1 && slow_runs == 1);
+  CHECK(sched.run());
+  CHECK(slow_runs == 2);
+  CHECK(!sched.run());
+}
+
+int main() {
+  test_fall_through();
+  return check_status();
+}
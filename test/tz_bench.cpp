@@ -0,0 +1,126 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the per-second cost of local time on the host over a span of seconds that crosses
+// transitions between standard and daylight time, both as it was, where the offset of the
+// timezone is recomputed from its rules and local time is split from scratch every second, and as
+// `local_clock::now()` does it, with offsets cached by the database until the next transition and
+// the calendar advanced incrementally. Also measured is switching to another timezone every second,
+// as when browsing with the TZ selector. Every method is checked to agree on the local time.
+
+#include <chrono>
+#include <vector>
+#include "clock.h"
+
+// 2025-03-01 00:00:00 UTC, followed by 90 days which cross the transitions of both hemispheres.
+static const time_t START_TIME = 1740787200;
+static const time_t SPAN_S = 90 * SECS_PER_DAY;
+
+// Number of times the span is measured, where the fastest pass is reported.
+static const int PASSES = 3;
+
+static uint32_t pack(const civil_time& ct) {
+  return ((ct.month * 32 + ct.day) * 24 + ct.hour) * 3600 + ct.minute * 60 + ct.second;
+}
+
+static uint32_t pack(const local_time& lt) {
+  return ((lt.month * 32 + lt.day) * 24 + lt.hour) * 3600 + lt.minute * 60 + lt.second;
+}
+
+// Runs the given method once per second of the span, returning the fastest pass in nanoseconds per
+// second and, from the first pass, the local time of every second.
+template <typename F>
+static double measure(std::vector<uint32_t>& times, F method) {
+  double best_ns = 1e9;
+  for (int pass = 0; pass < PASSES; ++pass) {
+    std::vector<uint32_t> out(SPAN_S);
+    auto start = std::chrono::steady_clock::now();
+    method(out);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed.count() / SPAN_S < best_ns)
+      best_ns = elapsed.count() / SPAN_S;
+    if (pass == 0)
+      times.swap(out);
+  }
+  return best_ns;
+}
+
+static bool report(const char* name, double ns, const std::vector<uint32_t>& times,
+    const std::vector<uint32_t>& expected) {
+  printf("%-10s %8.1f ns/s\n", name, ns);
+  for (time_t i = 0; i < SPAN_S; ++i) {
+    if (times[i] != expected[i]) {
+      fprintf(stderr, "%s: local time differs at %ld\n", name, static_cast<long>(START_TIME + i));
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  tz_database tz_db;
+  const char* name = argc > 1 ? argv[1] : "CET/CEST";
+  tz_info tz = tz_db.find(name);
+  if (strcmp(tz.name, name) != 0) {
+    fprintf(stderr, "%s: unknown timezone\n", name);
+    return 1;
+  }
+  printf("%s, %ld s\n", tz.name, static_cast<long>(SPAN_S));
+
+  std::vector<uint32_t> expected;
+  double recompute_ns = measure(expected, [&](std::vector<uint32_t>& out) {
+    for (time_t i = 0; i < SPAN_S; ++i) {
+      time_t next;
+      time_t t = START_TIME + i;
+      out[i] = pack(from_epoch(t + tz.get_offset(t, next)));
+    }
+  });
+  report("recompute", recompute_ns, expected, expected);
+
+  // Clock free-runs from a single synchronization, and simulated time advances by a second per
+  // call.
+  std::vector<uint32_t> times;
+  double cached_ns = measure(times, [&](std::vector<uint32_t>& out) {
+    host::set_us(0);
+    local_clock clock(&tz_db, tz);
+    clock.hold(gps_time { 2025, 3, 1, 0, 0, 0, 0, 0, 0 }, 0);
+    for (time_t i = 0; i < SPAN_S; ++i) {
+      clock.tick();
+      out[i] = pack(clock.now());
+      host::advance_us(1000000);
+    }
+  });
+  bool ok = report("cached", cached_ns, times, expected);
+
+  // Another timezone is previewed in between seconds, which requires no recomputation.
+  tz_info other = tz_db.find("UTC");
+  double browsing_ns = measure(times, [&](std::vector<uint32_t>& out) {
+    host::set_us(0);
+    local_clock clock(&tz_db, tz);
+    clock.hold(gps_time { 2025, 3, 1, 0, 0, 0, 0, 0, 0 }, 0);
+    for (time_t i = 0; i < SPAN_S; ++i) {
+      clock.tick();
+      clock.set_tz(other);
+      clock.now();
+      clock.set_tz(tz);
+      out[i] = pack(clock.now());
+      host::advance_us(1000000);
+    }
+  });
+  ok = report("browsing", browsing_ns, times, expected) && ok;
+  printf("speedup %.1fx\n", recompute_ns / cached_ns);
+  return ok ? 0 : 1;
+}
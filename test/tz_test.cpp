@@ -0,0 +1,52 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks that the index of timezone names is sorted and complete, so that every timezone can be
+// found by binary search. The database is compiled into the test so that the index, which is
+// private to it, can be inspected directly.
+
+#include "timezones.cpp"
+#include "check.h"
+
+static void test_index_sorted() {
+  bool listed[TZ_TABLE_SIZE] = {};
+  for (size_t i = 0; i < TZ_TABLE_SIZE; ++i) {
+    size_t index = TZ_INDEX[i];
+    CHECK(index < TZ_TABLE_SIZE && !listed[index]);
+    if (index < TZ_TABLE_SIZE)
+      listed[index] = true;
+    CHECK(i == 0 || strcmp(TZ_TABLE[TZ_INDEX[i - 1]].name, TZ_TABLE[index].name) < 0);
+  }
+}
+
+static void test_find() {
+  // Every timezone is found by name, whereas unknown names fall back to the first timezone.
+  tz_database tz_db;
+  for (size_t i = 0; i < tz_db.size(); ++i) {
+    tz_info tz = tz_db.get(i);
+    CHECK(tz_db.find_index(tz.name) == i);
+    CHECK(tz_db.find(tz.name).index == i);
+  }
+  for (const char* name : { "", "AAA", "Unknown", "zzz" })
+    CHECK(tz_db.find_index(name) == 0);
+}
+
+int main() {
+  test_index_sorted();
+  test_find();
+  return check_status();
+}
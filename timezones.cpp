@@ -14,303 +14,332 @@
  * limitations under the License.
  */
 #include "timezones.h"
-#include "board.h"
+#include "civil.h"
 
-// Array of predefined timezones where first entry must always be "UTC", thus array size is
-// guaranteed to be greater than zero. It should be safe to always reference first element.
-//
-// Note that names assigned to timezone change rules are irrelevant, so these are initialized
-// as empty strings to minimize consumption of RAM.
-//
-// Number of timezones depends on available RAM.
-static const tz_info TZ_TABLE[] = {
-  tz_info {
+// Array of predefined timezones in flash, ordered for browsing with the TZ selector, where first
+// entry must always be "UTC", thus array size is guaranteed to be greater than zero. It should be
+// safe to always reference first element.
+static const tz_entry TZ_TABLE[] PROGMEM = {
+  tz_entry {
     "UTC",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Mar, 1, 0}
-    )
+    tz_rule(Last, Sun, Mar, 1, 0),
+    tz_rule(Last, Sun, Mar, 1, 0)
   },
-#if RAM_SIZE > 2
   // Australian Central Standard Time
-  tz_info {
+  tz_entry {
     "ACST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 570}
-    )
+    tz_rule(First, Sun, Oct, 2, 570),
+    tz_rule(First, Sun, Oct, 2, 570)
   },
   // Australian Central Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "ACST/ACDT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Apr, 2, 630},
-      TimeChangeRule {"", First, Sun, Oct, 2, 570}
-    )
+    tz_rule(First, Sun, Apr, 2, 630),
+    tz_rule(First, Sun, Oct, 2, 570)
   },
   // Australian Eastern Standard Time
-  tz_info {
+  tz_entry {
     "AEST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 600}
-    )
+    tz_rule(First, Sun, Oct, 2, 600),
+    tz_rule(First, Sun, Oct, 2, 600)
   },
   // Australian Eastern Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "AEST/AEDT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Apr, 2, 660},
-      TimeChangeRule {"", First, Sun, Oct, 2, 600}
-    )
+    tz_rule(First, Sun, Apr, 2, 660),
+    tz_rule(First, Sun, Oct, 2, 600)
   },
   // Alaska Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "AKST/AKDT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -540},
-      TimeChangeRule {"", First, Sun, Nov, 2, -480}
-    )
+    tz_rule(Second, Sun, Mar, 2, -540),
+    tz_rule(First, Sun, Nov, 2, -480)
   },
   // Atlantic Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "AST/ADT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -240},
-      TimeChangeRule {"", First, Sun, Nov, 2, -180}
-    )
+    tz_rule(Second, Sun, Mar, 2, -240),
+    tz_rule(First, Sun, Nov, 2, -180)
   },
   // Australian Western Standard Time
-  tz_info {
+  tz_entry {
     "AWST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 480}
-    )
+    tz_rule(First, Sun, Oct, 2, 480),
+    tz_rule(First, Sun, Oct, 2, 480)
   },
   // Beijing Time
-  tz_info {
+  tz_entry {
     "BJT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 480}
-    )
+    tz_rule(First, Sun, Oct, 2, 480),
+    tz_rule(First, Sun, Oct, 2, 480)
   },
   // Central Africa Time
-  tz_info {
+  tz_entry {
     "CAT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 120}
-    )
+    tz_rule(First, Sun, Oct, 2, 120),
+    tz_rule(First, Sun, Oct, 2, 120)
   },
-#endif
   // Central European/Summer Time
-  tz_info {
+  tz_entry {
     "CET/CEST",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Mar, 2, 120},
-      TimeChangeRule {"", Last, Sun, Oct, 2, 60}
-    )
+    tz_rule(Last, Sun, Mar, 2, 120),
+    tz_rule(Last, Sun, Oct, 2, 60)
   },
-#if RAM_SIZE > 2
   // Chatham Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "CHAST/CHADT",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Sep, 2, 825},
-      TimeChangeRule {"", First, Sun, Apr, 2, 765}
-    )
+    tz_rule(Last, Sun, Sep, 2, 825),
+    tz_rule(First, Sun, Apr, 2, 765)
   },
-#endif
   // Central Standard/Daylight Time (US)
-  tz_info {
+  tz_entry {
     "CST/CDT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -300},
-      TimeChangeRule {"", First, Sun, Nov, 2, -360}
-    )
+    tz_rule(Second, Sun, Mar, 2, -300),
+    tz_rule(First, Sun, Nov, 2, -360)
   },
-#if RAM_SIZE > 2
   // Eastern Africa Time
-  tz_info {
+  tz_entry {
     "EAT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 180}
-    )
+    tz_rule(First, Sun, Oct, 2, 180),
+    tz_rule(First, Sun, Oct, 2, 180)
   },
-#endif
   // Eastern European Time
-  tz_info {
+  tz_entry {
     "EET",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Oct, 2, 120}
-    )
+    tz_rule(Last, Sun, Oct, 2, 120),
+    tz_rule(Last, Sun, Oct, 2, 120)
   },
   // Eastern European/Summer Time
-  tz_info {
+  tz_entry {
     "EET/EEST",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Mar, 2, 180},
-      TimeChangeRule {"", Last, Sun, Oct, 2, 120}
-    )
+    tz_rule(Last, Sun, Mar, 2, 180),
+    tz_rule(Last, Sun, Oct, 2, 120)
   },
   // Eastern Standard/Daylight Time (US)
-  tz_info {
+  tz_entry {
     "EST/EDT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -240},
-      TimeChangeRule {"", First, Sun, Nov, 2, -300}
-    )
+    tz_rule(Second, Sun, Mar, 2, -240),
+    tz_rule(First, Sun, Nov, 2, -300)
   },
-#if RAM_SIZE > 2
   // Indochina Time
-  tz_info {
+  tz_entry {
     "ICT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 420}
-    )
+    tz_rule(First, Sun, Oct, 2, 420),
+    tz_rule(First, Sun, Oct, 2, 420)
   },
   // Indian Standard Time
-  tz_info {
+  tz_entry {
     "IST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Nov, 2, 330}
-    )
+    tz_rule(First, Sun, Nov, 2, 330),
+    tz_rule(First, Sun, Nov, 2, 330)
   },
   // Japan Standard Time
-  tz_info {
+  tz_entry {
     "JST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Nov, 2, 540}
-    )
+    tz_rule(First, Sun, Nov, 2, 540),
+    tz_rule(First, Sun, Nov, 2, 540)
   },
   // Hawaii Standard Time
-  tz_info {
+  tz_entry {
     "HST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Nov, 2, -600}
-    )
+    tz_rule(First, Sun, Nov, 2, -600),
+    tz_rule(First, Sun, Nov, 2, -600)
   },
   // Hawaii Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "HST/HDT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -540},
-      TimeChangeRule {"", First, Sun, Nov, 2, -600}
-    )
+    tz_rule(Second, Sun, Mar, 2, -540),
+    tz_rule(First, Sun, Nov, 2, -600)
   },
   // Moscow Standard Time
-  tz_info {
+  tz_entry {
     "MSK",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 180}
-    )
+    tz_rule(First, Sun, Oct, 2, 180),
+    tz_rule(First, Sun, Oct, 2, 180)
   },
   // Mountain Standard Time (US)
-  tz_info {
+  tz_entry {
     "MST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Nov, 2, -420}
-    )
+    tz_rule(First, Sun, Nov, 2, -420),
+    tz_rule(First, Sun, Nov, 2, -420)
   },
-#endif
   // Mountain Standard/Daylight Time (US)
-  tz_info {
+  tz_entry {
     "MST/MDT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -360},
-      TimeChangeRule {"", First, Sun, Nov, 2, -420}
-    )
+    tz_rule(Second, Sun, Mar, 2, -360),
+    tz_rule(First, Sun, Nov, 2, -420)
   },
-#if RAM_SIZE > 2
   // New Zealand Standard/Daylight Time
-  tz_info {
+  tz_entry {
     "NZST/NZDT",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Sep, 2, 780},
-      TimeChangeRule {"", First, Sun, Apr, 2, 720}
-    )
+    tz_rule(Last, Sun, Sep, 2, 780),
+    tz_rule(First, Sun, Apr, 2, 720)
   },
   // Phillipine Standard Time
-  tz_info {
+  tz_entry {
     "PHST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 480}
-    )
+    tz_rule(First, Sun, Oct, 2, 480),
+    tz_rule(First, Sun, Oct, 2, 480)
   },
   // Pakistan Standard Time
-  tz_info {
+  tz_entry {
     "PKT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 300}
-    )
+    tz_rule(First, Sun, Oct, 2, 300),
+    tz_rule(First, Sun, Oct, 2, 300)
   },
-#endif
   // Pacific Standard/Daylight Time (US)
-  tz_info {
+  tz_entry {
     "PST/PDT",
-    Timezone(
-      TimeChangeRule {"", Second, Sun, Mar, 2, -420},
-      TimeChangeRule {"", First, Sun, Nov, 2, -480}
-    )
+    tz_rule(Second, Sun, Mar, 2, -420),
+    tz_rule(First, Sun, Nov, 2, -480)
   },
-#if RAM_SIZE > 2
   // South African Standard Time
-  tz_info {
+  tz_entry {
     "SAST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 120}
-    )
+    tz_rule(First, Sun, Oct, 2, 120),
+    tz_rule(First, Sun, Oct, 2, 120)
   },
   // Samoa Standard Time
-  tz_info {
+  tz_entry {
     "SST",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 480}
-    )
+    tz_rule(First, Sun, Oct, 2, 480),
+    tz_rule(First, Sun, Oct, 2, 480)
   },
   // West Africa Time
-  tz_info {
+  tz_entry {
     "WAT",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 60}
-    )
+    tz_rule(First, Sun, Oct, 2, 60),
+    tz_rule(First, Sun, Oct, 2, 60)
   },
   // Western European Time
-  tz_info {
+  tz_entry {
     "WET",
-    Timezone(
-      TimeChangeRule {"", First, Sun, Oct, 2, 0}
-    )
+    tz_rule(First, Sun, Oct, 2, 0),
+    tz_rule(First, Sun, Oct, 2, 0)
   },
   // Western European/Summer Time
-  tz_info {
+  tz_entry {
     "WET/WEST",
-    Timezone(
-      TimeChangeRule {"", Last, Sun, Mar, 2, 60},
-      TimeChangeRule {"", Last, Sun, Oct, 2, 0}
-    )
-  },
-#endif
+    tz_rule(Last, Sun, Mar, 2, 60),
+    tz_rule(Last, Sun, Oct, 2, 0)
+  }
 };
 
 // Number of timezones.
-static const size_t TZ_TABLE_SIZE = sizeof(TZ_TABLE) / sizeof(tz_info);
+static const size_t TZ_TABLE_SIZE = sizeof(TZ_TABLE) / sizeof(tz_entry);
+
+// Positions of timezones in TZ_TABLE ordered by name, which must be kept consistent with the table
+// so that timezones can be found by binary search.
+static const uint8_t TZ_INDEX[] PROGMEM = {
+  1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 20, 21, 17, 18, 19, 22, 23, 24, 25, 26,
+  27, 28, 29, 30, 0, 31, 32, 33
+};
+
+static_assert(sizeof(TZ_INDEX) == TZ_TABLE_SIZE, "TZ_INDEX must list every entry of TZ_TABLE");
+
+static time_t start_of(const tz_rule& rule, int yr) {
+  // Local time at which the rule takes effect in the given year, where a week of `Last` is
+  // found by counting back from the first week of the following month.
+  uint8_t m = rule.month();
+  uint8_t w = rule.week();
+  if (w == Last) {
+    if (++m > 12) {
+      m = 1;
+      ++yr;
+    }
+    w = First;
+  }
+  int32_t days = days_from_civil(yr, m, 1);
+  days += (rule.dow() - weekday_from_days(days) + 7) % 7 + (w - 1) * 7;
+  if (rule.week() == Last)
+    days -= 7;
+  return static_cast<time_t>(days) * SECS_PER_DAY + rule.hour() * SECS_PER_HOUR;
+}
+
+int32_t tz_entry::get_offset(time_t utc, time_t& next) const {
+  // Offset in seconds of local time from UTC at the given instant, along with the instant at which
+  // the offset next changes. Transitions are computed for the current UTC year, so the start of the
+  // following year is also reported as a change even though the offset rarely differs.
+  int yr = from_epoch(utc).year;
+  next = to_epoch(yr + 1, 1, 1, 0, 0, 0);
+  if (dst.offset == std.offset)
+    return std.offset * SECS_PER_MIN;
+
+  time_t dst_utc = start_of(dst, yr) - std.offset * SECS_PER_MIN;
+  time_t std_utc = start_of(std, yr) - dst.offset * SECS_PER_MIN;
+  if (dst_utc > utc && dst_utc < next)
+    next = dst_utc;
+  if (std_utc > utc && std_utc < next)
+    next = std_utc;
+  bool daylight = std_utc > dst_utc ?
+    utc >= dst_utc && utc < std_utc :
+    !(utc >= std_utc && utc < dst_utc);
+  return (daylight ? dst.offset : std.offset) * SECS_PER_MIN;
+}
 
-tz_database::tz_database() {
+tz_database::tz_database()
+  : offsets(new int16_t[TZ_TABLE_SIZE]),
+    offsets_from(0),
+    offsets_until(0),
+    offsets_valid(false) {
 }
 
 size_t tz_database::size() const {
   return TZ_TABLE_SIZE;
 }
 
-const tz_info* const tz_database::find(const char* name) const {
-  return &TZ_TABLE[find_index(name)];
+tz_info tz_database::find(const char* name) const {
+  return load(find_index(name));
 }
 
 size_t tz_database::find_index(const char* name) const {
-  for (size_t i = 0; i < TZ_TABLE_SIZE; ++i) {
-    if (strcmp(TZ_TABLE[i].name, name) == 0)
-      return i;
+  // Binary search of the name index, which compares names in flash without copying them.
+  size_t lo = 0;
+  size_t hi = TZ_TABLE_SIZE;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    size_t index = pgm_read_byte(&TZ_INDEX[mid]);
+    int cmp = strcmp_P(name, TZ_TABLE[index].name);
+    if (cmp == 0)
+      return index;
+    else if (cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
   }
   return 0;
 }
 
-const tz_info* const tz_database::get(size_t index) const {
-  return &TZ_TABLE[index < TZ_TABLE_SIZE ? index : 0];
+tz_info tz_database::get(size_t index) const {
+  return load(index < TZ_TABLE_SIZE ? index : 0);
+}
+
+void tz_database::update(time_t utc) {
+  // Offsets remain valid until the earliest transition of any timezone, or until the clock is
+  // stepped back before the time at which they were computed. Each timezone is copied from flash
+  // only for as long as it takes to compute its offset.
+  if (offsets_valid && utc >= offsets_from && utc < offsets_until)
+    return;
+  for (size_t i = 0; i < TZ_TABLE_SIZE; ++i) {
+    tz_entry entry;
+    memcpy_P(&entry, &TZ_TABLE[i], sizeof(tz_entry));
+    time_t next;
+    offsets[i] = entry.get_offset(utc, next) / static_cast<int32_t>(SECS_PER_MIN);
+    if (i == 0 || next < offsets_until)
+      offsets_until = next;
+  }
+  offsets_from = utc;
+  offsets_valid = true;
+}
+
+int32_t tz_database::get_offset(size_t index) const {
+  // Offset in seconds of the timezone at the given index as of the last update.
+  return offsets[index] * static_cast<int32_t>(SECS_PER_MIN);
+}
+
+tz_info tz_database::load(size_t index) const {
+  tz_info tz;
+  memcpy_P(static_cast<tz_entry*>(&tz), &TZ_TABLE[index], sizeof(tz_entry));
+  tz.index = index;
+  return tz;
 }
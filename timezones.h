@@ -21,18 +21,63 @@
 
 static const size_t TZ_NAME_SIZE = 15;
 
-struct tz_info {
-  const char* const name;
-  Timezone tz;
+// Rule for the start of daylight or standard time, as interpreted by the Timezone library, packed
+// into 4 bytes where the week, day of week, month and hour occupy 3, 3, 4 and 5 bits, respectively,
+// and the offset from UTC is in minutes.
+struct tz_rule {
+  uint16_t when;
+  int16_t offset;
+
+  tz_rule() = default;
+  constexpr tz_rule(uint8_t week, uint8_t dow, uint8_t month, uint8_t hour, int16_t offset)
+    : when(week | dow << 3 | month << 6 | hour << 10),
+      offset(offset) {
+  }
+  uint8_t week() const { return when & 0x07; }
+  uint8_t dow() const { return when >> 3 & 0x07; }
+  uint8_t month() const { return when >> 6 & 0x0F; }
+  uint8_t hour() const { return when >> 10 & 0x1F; }
+};
+
+// Timezone described by the rules for the start of daylight and standard time, which are
+// identical when the timezone does not observe daylight time. Entries of the database reside in
+// flash.
+struct tz_entry {
+  char name[TZ_NAME_SIZE + 1];
+  tz_rule dst;
+  tz_rule std;
+
+  int32_t get_offset(time_t utc, time_t& next) const;
 };
 
+// Timezone copied from flash into RAM along with its position in the database.
+struct tz_info : tz_entry {
+  size_t index;
+};
+
+// Database of predefined timezones, which also keeps the current offset from UTC of every timezone
+// so that switching between timezones, e.g. while browsing with the TZ selector, costs no more than
+// a lookup. Offsets are only recomputed once any timezone passes a transition.
+//
+// Timezones are copied from flash only on demand, so `find()` and `get()` return a copy that the
+// caller keeps only as long as needed, whereas the clock refers to its timezone by index.
 class tz_database {
 public:
   tz_database();
   size_t size() const;
-  const tz_info* const find(const char* name) const;
+  tz_info find(const char* name) const;
   size_t find_index(const char* name) const;
-  const tz_info* const get(size_t index) const;
+  tz_info get(size_t index) const;
+  void update(time_t utc);
+  int32_t get_offset(size_t index) const;
+
+private:
+  int16_t* offsets;
+  time_t offsets_from;
+  time_t offsets_until;
+  bool offsets_valid;
+
+  tz_info load(size_t index) const;
 };
 
 #endif
@@ -0,0 +1,377 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ubx.h"
+
+// Synchronization characters at the head of every frame.
+static const uint8_t UBX_SYNC_1 = 0xB5;
+static const uint8_t UBX_SYNC_2 = 0x62;
+
+// Message class and identifiers of decoded messages.
+static const uint8_t UBX_NAV = 0x01;
+static const uint8_t UBX_NAV_POSLLH = 0x02;
+static const uint8_t UBX_NAV_SOL = 0x06;
+static const uint8_t UBX_NAV_PVT = 0x07;
+static const uint8_t UBX_NAV_TIMEUTC = 0x21;
+
+// Payload lengths of decoded messages, which are used to reject messages from incompatible
+// protocol versions.
+static const uint16_t LEN_NAV_POSLLH = 28;
+static const uint16_t LEN_NAV_SOL = 52;
+static const uint16_t LEN_NAV_PVT = 92;
+static const uint16_t LEN_NAV_TIMEUTC = 20;
+
+// Frames longer than this are presumed to be the result of a false synchronization, since no
+// message of interest comes close.
+static const uint16_t MAX_LEN = 512;
+
+// Validity flags of NAV-TIMEUTC and NAV-PVT, respectively.
+static const uint8_t TIMEUTC_VALID_UTC = 0x04;
+static const uint8_t PVT_VALID_TIME = 0x07;
+
+// Flag in NAV-SOL and NAV-PVT indicating that the fix is within accuracy limits.
+static const uint8_t FLAG_FIX_OK = 0x01;
+
+// Fix types from 2D through time-only indicate a usable fix, where time-only is reported by timing
+// modules operating from a fixed position.
+static const uint8_t FIX_TYPE_2D = 2;
+static const uint8_t FIX_TYPE_TIME = 5;
+
+ubx_parser::ubx_parser()
+  : fix {},
+    pending {},
+    state(state_sync_1),
+    message(ubx_unknown),
+    cls(0),
+    id(0),
+    len(0),
+    offset(0),
+    ck_a(0),
+    ck_b(0),
+    window(0),
+    active(false),
+    timed(false),
+    sentences(0),
+    checksum_errors(0) {
+  fix.accuracy_ns = ACCURACY_UNKNOWN;
+}
+
+bool ubx_parser::encode(char c) {
+  uint8_t b = c;
+  switch (state) {
+    case state_sync_1:
+      if (b == UBX_SYNC_1)
+        state = state_sync_2;
+      return false;
+    case state_sync_2:
+      state = b == UBX_SYNC_2 ? state_class : state_sync_1;
+      return false;
+    default:
+      break;
+  }
+
+  // Checksum is an 8-bit Fletcher algorithm over everything but the sync characters and the
+  // checksum itself.
+  if (state < state_ck_a) {
+    ck_a += b;
+    ck_b += ck_a;
+  }
+
+  switch (state) {
+    case state_class:
+      cls = b;
+      ck_a = b;
+      ck_b = b;
+      state = state_id;
+      break;
+    case state_id:
+      id = b;
+      state = state_len_1;
+      break;
+    case state_len_1:
+      len = b;
+      state = state_len_2;
+      break;
+    case state_len_2:
+      len |= static_cast<uint16_t>(b) << 8;
+      if (len > MAX_LEN) {
+        state = state_sync_1;
+      } else {
+        message = to_message(cls, id, len);
+        pending = fix;
+        offset = 0;
+        state = len > 0 ? state_payload : state_ck_a;
+      }
+      break;
+    case state_payload:
+      // Multi-byte fields are little-endian, so once the last byte of a field arrives, the field
+      // occupies the upper bytes of the sliding window.
+      window = (window >> 8) | (static_cast<uint32_t>(b) << 24);
+      decode();
+      if (++offset == len)
+        state = state_ck_a;
+      break;
+    case state_ck_a:
+      state = b == ck_a ? state_ck_b : state_sync_1;
+      if (state == state_sync_1)
+        ++checksum_errors;
+      break;
+    case state_ck_b:
+      state = state_sync_1;
+      if (b != ck_b) {
+        ++checksum_errors;
+        return false;
+      }
+      ++sentences;
+      return message != ubx_unknown && commit();
+    default:
+      break;
+  }
+  return false;
+}
+
+bool ubx_parser::is_start(char c) const {
+  return state == state_sync_1 && static_cast<uint8_t>(c) == UBX_SYNC_1;
+}
+
+const gps_fix& ubx_parser::get_fix() const {
+  return fix;
+}
+
+ubx_message ubx_parser::get_message() const {
+  return message;
+}
+
+bool ubx_parser::has_time() const {
+  return timed;
+}
+
+uint32_t ubx_parser::get_sentences() const {
+  return sentences;
+}
+
+uint16_t ubx_parser::get_checksum_errors() const {
+  return checksum_errors;
+}
+
+void ubx_parser::decode() {
+  switch (message) {
+    case ubx_nav_posllh:
+      decode_posllh();
+      break;
+    case ubx_nav_sol:
+      decode_sol();
+      break;
+    case ubx_nav_pvt:
+      decode_pvt();
+      break;
+    case ubx_nav_timeutc:
+      decode_timeutc();
+      break;
+    default:
+      break;
+  }
+}
+
+void ubx_parser::decode_posllh() {
+  switch (offset) {
+    case 7:
+      pending.lon = i4() / 1e7;
+      break;
+    case 11:
+      pending.lat = i4() / 1e7;
+      break;
+    case 19:
+      pending.altitude = i4() / 1e3;
+      break;
+  }
+}
+
+void ubx_parser::decode_sol() {
+  switch (offset) {
+    case 10:
+      pending.quality = u1();
+      break;
+    case 11:
+      active = is_active(pending.quality, u1());
+      break;
+    case 45:
+      // Only PDOP is reported, which is never less than HDOP and therefore a conservative
+      // substitute.
+      pending.hdop = u2() / 100.0;
+      break;
+    case 47:
+      pending.satellites = u1();
+      break;
+  }
+}
+
+void ubx_parser::decode_pvt() {
+  switch (offset) {
+    case 5:
+      pending.year = u2();
+      break;
+    case 6:
+      pending.month = u1();
+      break;
+    case 7:
+      pending.day = u1();
+      break;
+    case 8:
+      pending.hour = u1();
+      break;
+    case 9:
+      pending.minute = u1();
+      break;
+    case 10:
+      pending.second = u1();
+      break;
+    case 11:
+      timed = (u1() & PVT_VALID_TIME) == PVT_VALID_TIME;
+      break;
+    case 15:
+      pending.accuracy_ns = i4();
+      break;
+    case 19:
+      pending.nano = i4();
+      break;
+    case 20:
+      pending.quality = u1();
+      break;
+    case 21:
+      active = is_active(pending.quality, u1());
+      break;
+    case 23:
+      pending.satellites = u1();
+      break;
+    case 27:
+      pending.lon = i4() / 1e7;
+      break;
+    case 31:
+      pending.lat = i4() / 1e7;
+      break;
+    case 39:
+      pending.altitude = i4() / 1e3;
+      break;
+    case 77:
+      pending.hdop = u2() / 100.0;
+      break;
+  }
+}
+
+void ubx_parser::decode_timeutc() {
+  switch (offset) {
+    case 7:
+      pending.accuracy_ns = i4();
+      break;
+    case 11:
+      pending.nano = i4();
+      break;
+    case 13:
+      pending.year = u2();
+      break;
+    case 14:
+      pending.month = u1();
+      break;
+    case 15:
+      pending.day = u1();
+      break;
+    case 16:
+      pending.hour = u1();
+      break;
+    case 17:
+      pending.minute = u1();
+      break;
+    case 18:
+      pending.second = u1();
+      break;
+    case 19:
+      timed = (u1() & TIMEUTC_VALID_UTC) != 0;
+      break;
+  }
+}
+
+bool ubx_parser::commit() {
+  // Each message only overwrites those fields it carries, where time and position are discarded
+  // unless the module vouches for them.
+  bool has_quality = message == ubx_nav_sol || message == ubx_nav_pvt;
+  bool has_position = message == ubx_nav_posllh || message == ubx_nav_pvt;
+  bool has_time = message == ubx_nav_timeutc || message == ubx_nav_pvt;
+
+  if (has_quality) {
+    pending.active = active;
+    pending.quality_ms = millis();
+    pending.valid |= FIX_QUALITY | FIX_SATELLITES;
+  }
+  if (has_position) {
+    if (pending.active) {
+      pending.valid |= FIX_LOCATION | FIX_ALTITUDE;
+    } else {
+      pending.lat = fix.lat;
+      pending.lon = fix.lon;
+      pending.altitude = fix.altitude;
+    }
+  }
+  if (has_time) {
+    if (timed) {
+      pending.centisecond = pending.nano > 0 ? pending.nano / 10000000L : 0;
+      pending.valid |= FIX_TIME | FIX_DATE;
+    } else {
+      pending.year = fix.year;
+      pending.month = fix.month;
+      pending.day = fix.day;
+      pending.hour = fix.hour;
+      pending.minute = fix.minute;
+      pending.second = fix.second;
+      pending.nano = fix.nano;
+      pending.accuracy_ns = fix.accuracy_ns;
+    }
+  } else {
+    timed = false;
+  }
+  fix = pending;
+  return true;
+}
+
+int32_t ubx_parser::i4() const {
+  return static_cast<int32_t>(window);
+}
+
+uint16_t ubx_parser::u2() const {
+  return window >> 16;
+}
+
+uint8_t ubx_parser::u1() const {
+  return window >> 24;
+}
+
+ubx_message ubx_parser::to_message(uint8_t cls, uint8_t id, uint16_t len) {
+  if (cls != UBX_NAV)
+    return ubx_unknown;
+  else if (id == UBX_NAV_POSLLH && len == LEN_NAV_POSLLH)
+    return ubx_nav_posllh;
+  else if (id == UBX_NAV_SOL && len == LEN_NAV_SOL)
+    return ubx_nav_sol;
+  else if (id == UBX_NAV_PVT && len == LEN_NAV_PVT)
+    return ubx_nav_pvt;
+  else if (id == UBX_NAV_TIMEUTC && len == LEN_NAV_TIMEUTC)
+    return ubx_nav_timeutc;
+  else
+    return ubx_unknown;
+}
+
+bool ubx_parser::is_active(uint8_t fix_type, uint8_t flags) {
+  return (flags & FLAG_FIX_OK) && fix_type >= FIX_TYPE_2D && fix_type <= FIX_TYPE_TIME;
+}
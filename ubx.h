@@ -0,0 +1,89 @@
+/*
+ * Copyright 2025 David Edwards
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __UBX_H
+#define __UBX_H
+
+#include <Arduino.h>
+#include "gpsfix.h"
+
+enum ubx_message {
+  ubx_unknown,
+  ubx_nav_posllh,
+  ubx_nav_sol,
+  ubx_nav_pvt,
+  ubx_nav_timeutc
+};
+
+// Incremental parser that decodes only the UBX-NAV messages from which position and time are
+// derived. Fields are extracted as payload bytes arrive, so frames are never buffered.
+//
+// NAV-POSLLH, NAV-SOL and NAV-TIMEUTC are understood by all u-blox modules, including the NEO-6M,
+// whereas NAV-PVT combines all three on newer modules.
+class ubx_parser {
+public:
+  ubx_parser();
+  bool encode(char c);
+  bool is_start(char c) const;
+  const gps_fix& get_fix() const;
+  ubx_message get_message() const;
+  bool has_time() const;
+  uint32_t get_sentences() const;
+  uint16_t get_checksum_errors() const;
+
+private:
+  enum parse_state {
+    state_sync_1,
+    state_sync_2,
+    state_class,
+    state_id,
+    state_len_1,
+    state_len_2,
+    state_payload,
+    state_ck_a,
+    state_ck_b
+  };
+
+  gps_fix fix;
+  gps_fix pending;
+  parse_state state;
+  ubx_message message;
+  uint8_t cls;
+  uint8_t id;
+  uint16_t len;
+  uint16_t offset;
+  uint8_t ck_a;
+  uint8_t ck_b;
+  uint32_t window;
+  bool active;
+  bool timed;
+  uint32_t sentences;
+  uint16_t checksum_errors;
+
+  void decode();
+  void decode_posllh();
+  void decode_sol();
+  void decode_pvt();
+  void decode_timeutc();
+  bool commit();
+  int32_t i4() const;
+  uint16_t u2() const;
+  uint8_t u1() const;
+
+  static ubx_message to_message(uint8_t cls, uint8_t id, uint16_t len);
+  static bool is_active(uint8_t fix_type, uint8_t flags);
+};
+
+#endif